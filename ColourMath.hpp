@@ -0,0 +1,78 @@
+/*
+ * File name: ColourMath.hpp
+ * File description: Per-pixel colour conversions matching OpenCV's 8-bit results.
+ *
+ */
+
+#ifndef _ColourMath_HPP_
+#define _ColourMath_HPP_
+
+#include <algorithm>
+
+#define HSV_SHIFT 12
+
+// division tables used by cv::cvtColor(COLOR_BGR2HSV) for 8-bit images
+struct HsvDivTables
+{
+    int hdiv[256];
+    int sdiv[256];
+
+    HsvDivTables()
+    {
+        hdiv[0] = sdiv[0] = 0;
+        for (int i = 1; i < 256; i++) {
+            hdiv[i] = (int) (((180 << HSV_SHIFT) / (6.0 * i)) + 0.5);
+            sdiv[i] = (int) (((255 << HSV_SHIFT) / (1.0 * i)) + 0.5);
+        }
+    }
+};
+
+inline const HsvDivTables& hsvDiv()
+{
+    static const HsvDivTables t;
+    return t;
+}
+
+// hue only (0..179), same value as channel 0 of COLOR_BGR2HSV
+inline int BgrToHue(int b, int g, int r, const HsvDivTables& t)
+{
+    int v = std::max(std::max(b, g), r);
+    int diff = v - std::min(std::min(b, g), r);
+    int vr = (v == r) ? -1 : 0;
+    int vg = (v == g) ? -1 : 0;
+
+    int h = (vr & (g - b)) + (~vr & ((vg & (b - r + 2 * diff)) + ((~vg) & (r - g + 4 * diff))));
+    h = (h * t.hdiv[diff] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+
+    return h + ((h < 0) ? 180 : 0);
+}
+
+// full conversion, same values as COLOR_BGR2HSV
+inline void BgrToHsv(int b, int g, int r, int& h, int& s, int& v, const HsvDivTables& t)
+{
+    v = std::max(std::max(b, g), r);
+    int diff = v - std::min(std::min(b, g), r);
+
+    s = (diff * t.sdiv[v] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+    h = BgrToHue(b, g, r, t);
+}
+
+// BT.601 limited range, as used by COLOR_YUV2BGR_NV12 and COLOR_YUV2BGR_YUYV
+inline void YuvToBgr(int y, int u, int v, int& b, int& g, int& r)
+{
+    double c = 1.164 * (y - 16);
+
+    r = std::min(255, std::max(0, (int) (c + 1.596 * (v - 128) + 0.5)));
+    g = std::min(255, std::max(0, (int) (c - 0.813 * (v - 128) - 0.391 * (u - 128) + 0.5)));
+    b = std::min(255, std::max(0, (int) (c + 2.018 * (u - 128) + 0.5)));
+}
+
+// pixel inside the threshold range {lhue, hhue, lsat, hsat, lval, hval}, hue wraps when lhue > hhue
+inline bool InRangeHsv(int h, int s, int v, const int hsv[6])
+{
+    bool hue = (hsv[0] <= hsv[1]) ? (h >= hsv[0] && h <= hsv[1]) : (h >= hsv[0] || h <= hsv[1]);
+
+    return hue && s >= hsv[2] && s <= hsv[3] && v >= hsv[4] && v <= hsv[5];
+}
+
+#endif
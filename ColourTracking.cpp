@@ -13,45 +13,129 @@
 
 #include <vector>
 #include <iostream>
+#include <algorithm>
+#include <cerrno>
 
 /** Includes for socket communication **/
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <unistd.h>
 
 using namespace cv;
 using namespace std::chrono;
 
 void ColourTracking::Process() // main process
 {   
-    ThresholdImage(imgOriginal, imgThresh, iHSV, bThreshBlur);
+    frame_time = duration_cast<milliseconds> (system_clock::now().time_since_epoch()).count();
     
-    MorphImage(iMorphLevel, MORPH_KERNEL_SIZE, imgThresh, imgThresh);
+    UpdateConfig(); /* frame boundary: the config can't change until the next call */
+    
+    if (iDebugLevel >= 2) DebugLogOn(); /* level can be raised at runtime (trackbar) */
+    
+    if (iInputFormat != INPUT_BGR) PrepareYUV();
+    
+    if (uiPyramid > 0 && iCount > 0) {
+        
+        /* threshold and morph only run at full resolution inside candidate regions */
+        FindObjectsPyramid(FrameSize(), uiPyramid, cfg->p.minsize, cfg->p.maxsize, vecFoundObjects);
+    }
+    else {
+        
+        bool sparse = (bSparse && iCount > 0);
+        
+        if (sparse) tmOccupied.Reset(FrameSize());
+        
+        ThresholdFrame(cv::Rect(cv::Point(0, 0), FrameSize()), 1, imgThresh, sparse ? &tmOccupied : NULL);
+        
+        if (sparse) sparse = tmOccupied.Regions(vecRegions); /* falls back to the whole frame when it's mostly occupied */
+        
+        if (sparse) {
+            
+            for (unsigned int i = 0; i < vecRegions.size(); i++) {
+                cv::Mat region = imgThresh(vecRegions[i]); /* morphed in place */
+                MorphFrame(region, region);
+            }
+            
+            FindObjectsSparse(imgThresh, vecRegions, cfg->p.minsize, cfg->p.maxsize, vecFoundObjects);
+        }
+        else {
+            
+            MorphFrame(imgThresh, imgThresh);
+            
+            if (iCount > 0) FindObjects(imgThresh, cfg->p.minsize, cfg->p.maxsize, vecFoundObjects);
+        }
+    }
     
     if (iCount > 0){
         
-        FindObjects(imgThresh, ObjectMinsize, ObjectMaxsize, vecFoundObjects);
+        AddNewObjects(vecFoundObjects, tsExistingObjects);
+        ExistentialObjects(vecFoundObjects, tsExistingObjects);
+        
+        CleanupObjects(tsExistingObjects);
         
-        AddNewObjects(vecFoundObjects, vecExistingObjects);
-        ExistentialObjects(vecFoundObjects, vecExistingObjects);
+        tlTrackLog.Write(uiFrameNr, frame_time, tsExistingObjects, MinLife); /* no-op unless -tracklog is given */
+        
+        unsigned long tldropped = tlTrackLog.droppedFrames(), tltruncated = tlTrackLog.truncatedFrames();
+        if (tldropped + tltruncated != ulTrackLogLoss) { /* lost frames are reported at any debug level */
+            int32_t v[2] = { (int32_t) tldropped, (int32_t) tltruncated };
+            DebugLogOn();
+            dlDebug.Log(debuglog::TRACKLOG_LOSS, uiFrameNr, frame_time, v, 2);
+            ulTrackLogLoss = tldropped + tltruncated;
+        }
         
-        CleanupObjects(vecExistingObjects);
+        WriteSendBuffer(tsExistingObjects, CommSendBuffer); /* write useful info to buffer */
         
-        WriteSendBuffer(vecExistingObjects, CommSendBuffer); /* write useful info to buffer */
+        sfState.Save(frame_time, uiFrameNr, uiCaptureWidth, uiCaptureHeight, tsExistingObjects, vecOrder, IDcounter); /* no-op unless -statefile is given */
 
     } 
     else {
         IDcounter = 0;  /* reset ID counter */
-        if (!vecExistingObjects.empty()) vecExistingObjects.clear();
+        if (!tsExistingObjects.empty()) tsExistingObjects.Clear();
     }
     
     RecvSend(CommPassBuffer, CommSendBuffer); /* transmit buffer via UDP */
     
-    DrawCircles(imgOriginal, imgCircles, vecExistingObjects);
+    if (bStartupReport) { /* first result is out */
+        stStartup.Mark("first result");
+        std::cout << ts() << " Startup: " << stStartup.Report() << std::endl;
+        bStartupReport = false;
+    }
+    
+    // overlays are only drawn when a window or a preview client will see them
+    bool bDrawOriginal = (bGUI && iShowOriginal == ENABLED);
+    bool bPreview = psPreview.Wanted();
+    
+    if (bDrawOriginal || bPreview) {
+        
+        bool convert = (iInputFormat != INPUT_BGR && bDrawOriginal); /* YUV input is only converted when a window shows it */
+        
+        if (convert) RawToBGR();
+        
+        CollectOverlay(tsExistingObjects, vecOverlay);
+        
+        /* preview thread converts, scales and draws its own copy */
+        if (bPreview && (iInputFormat == INPUT_BGR || convert)) psPreview.Submit(imgOriginal, vecOverlay);
+        else if (bPreview) psPreview.Submit(imgRaw, vecOverlay, RawConversion());
+        if (bDrawOriginal) PreviewStream::DrawCircles(imgOriginal, vecOverlay, 1.0); /* in place */
+    }
+    
+    uiFrameNr++;
 }
 
 /******** Functions regarding detection and storage of objects ********/
+// raster order of the top left corner, so objects come out in the same order however the mask was searched
+static bool ContourBefore(const std::vector<cv::Point>& a, const std::vector<cv::Point>& b)
+{
+    cv::Rect ra = cv::boundingRect(a), rb = cv::boundingRect(b);
+    
+    if (ra.y != rb.y) return ra.y < rb.y;
+    if (ra.x != rb.x) return ra.x < rb.x;
+    
+    return a.size() < b.size();
+}
+
 int ColourTracking::FindObjects(cv::Mat src, float minsize, float maxsize, std::vector<Object>& found)
 {
     cv::Mat imgBuffer8u;
@@ -61,9 +145,122 @@ int ColourTracking::FindObjects(cv::Mat src, float minsize, float maxsize, std::
     std::vector<std::vector<cv::Point> > contours;
     
     cv::findContours(imgBuffer8u, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+    std::sort(contours.begin(), contours.end(), ContourBefore);
     
     found.clear(); // clear vector to make room for new objects
     
+    ContoursToObjects(contours, minsize, maxsize, found);
+    
+    // returns number of mass centers (aka objects)
+    return found.size();
+}
+
+int ColourTracking::FindObjectsSparse(cv::Mat src, const std::vector<cv::Rect>& regions, float minsize, float maxsize, std::vector<Object>& found)
+{
+    std::vector<std::vector<cv::Point> > contours, part;
+    
+    for (unsigned int i = 0; i < regions.size(); i++) {
+        
+        cv::Mat imgBuffer8u = src(regions[i]).clone(); /* findContours may write to its input */
+        
+        part.clear();
+        cv::findContours(imgBuffer8u, part, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE, regions[i].tl());
+        
+        contours.insert(contours.end(), part.begin(), part.end());
+    }
+    
+    std::sort(contours.begin(), contours.end(), ContourBefore);
+    
+    found.clear(); // clear vector to make room for new objects
+    
+    ContoursToObjects(contours, minsize, maxsize, found);
+    
+    // returns number of mass centers (aka objects)
+    return found.size();
+}
+
+int ColourTracking::FindObjectsPyramid(cv::Size size, unsigned int level, float minsize, float maxsize, std::vector<Object>& found)
+{
+    int scale = 1 << level;
+    int pad = 2 * scale + 2 * MORPH_KERNEL_SIZE + 2; /* covers downscale rounding, blur and morph reach */
+    
+    cv::Mat imgSmallThresh;
+    cv::Rect frame(cv::Point(0, 0), size);
+    
+    // coarse pass: threshold a reduced copy of the frame to find candidate blobs
+    ThresholdFrame(frame, scale, imgSmallThresh, NULL);
+    
+    std::vector<std::vector<cv::Point> > contours;
+    
+    cv::findContours(imgSmallThresh, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+    
+    std::vector<cv::Rect> boxes; // candidate regions in full resolution coordinates
+    
+    for (unsigned int i = 0; i < contours.size(); i++) {
+        
+        cv::Rect box = cv::boundingRect(contours[i]);
+        
+        // limits are loose here, area is measured properly at full resolution
+        if (box.area() * scale * scale < minsize / 2) continue;
+        if (contourArea(contours[i]) * scale * scale > maxsize * 2) continue;
+        
+        box = cv::Rect(box.x * scale - pad, box.y * scale - pad, box.width * scale + 2 * pad, box.height * scale + 2 * pad) & frame;
+        
+        // merge with overlapping candidates so no blob is measured twice
+        for (unsigned int j = 0; j < boxes.size(); ) {
+            if ((box & boxes[j]).area() > 0) {
+                box |= boxes[j];
+                boxes.erase(boxes.begin() + j);
+                j = 0;
+            }
+            else j++;
+        }
+        
+        boxes.push_back(box);
+    }
+    
+    // full resolution mask is only assembled when someone looks at it
+    bool keepThresh = (bGUI && iShowThresh == ENABLED);
+    if (keepThresh) imgThresh = cv::Mat::zeros(size, CV_8U);
+    
+    found.clear(); // clear vector to make room for new objects
+    
+    // fine pass: threshold, morph and measure each candidate at full resolution
+    for (unsigned int i = 0; i < boxes.size(); i++) {
+        
+        cv::Mat roiThresh;
+        
+        ThresholdFrame(boxes[i], 1, roiThresh, NULL);
+        MorphFrame(roiThresh, roiThresh);
+        
+        if (keepThresh) roiThresh.copyTo(imgThresh(boxes[i]));
+        
+        contours.clear();
+        cv::findContours(roiThresh, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE, boxes[i].tl());
+        
+        // a contour reaching an inner edge of the box belongs to a blob that continues outside it,
+        // one the coarse pass dropped (e.g. too large), only a piece of it would be measured here
+        cv::Rect inner(boxes[i].x + 1, boxes[i].y + 1, boxes[i].width - 2, boxes[i].height - 2);
+        
+        for (unsigned int j = 0; j < contours.size(); ) {
+            cv::Rect r = cv::boundingRect(contours[j]);
+            bool cut = (r.x <= inner.x && boxes[i].x > frame.x) ||
+                       (r.y <= inner.y && boxes[i].y > frame.y) ||
+                       (r.br().x >= inner.br().x && boxes[i].br().x < frame.br().x) ||
+                       (r.br().y >= inner.br().y && boxes[i].br().y < frame.br().y);
+            if (cut) contours.erase(contours.begin() + j);
+            else j++;
+        }
+        
+        ContoursToObjects(contours, minsize, maxsize, found);
+    }
+    
+    // returns number of mass centers (aka objects)
+    return found.size();
+}
+
+void ColourTracking::ContoursToObjects(std::vector<std::vector<cv::Point> >& contours, float minsize, float maxsize, std::vector<Object>& found)
+{
     std::vector<cv::Moments> mv; // temporary moment vector 
     std::vector<float> sv; // temporary area vector 
     std::vector<cv::Point> mc; // temporary mass center vector (location) 
@@ -87,93 +284,75 @@ int ColourTracking::FindObjects(cv::Mat src, float minsize, float maxsize, std::
         mc.push_back (cv::Point((int) (mv[i].m10/mv[i].m00), (int) (mv[i].m01/mv[i].m00)));
         
         // Object arguments: new index, x, y, area, coordinate margin, remove counter
-        found.push_back (Object(i, (int) mc[i].x, (int) mc[i].y, sv[i], rm_default, iHSV));
+        found.push_back (Object(found.size(), (int) mc[i].x, (int) mc[i].y, sv[i], cfg->p.rmdefault, cfg->p.hsv));
     }
-    
-    // returns number of mass centers (aka objects)
-    return found.size();
 }
 
-unsigned int ColourTracking::AddNewObjects(std::vector<Object> found, std::vector<Object>& exist)
+unsigned int ColourTracking::AddNewObjects(const std::vector<Object>& found, TrackStore& exist)
 {
     bool isnew = true;
     
-    if (!exist.empty()) {         
-        if (!found.empty()) {
-            
-            // add currently found objects to vecExistingObjects
-            for (unsigned int i = 0; i < found.size(); i++) {
-                
-                isnew = true;
-                
-                for (unsigned int j = 0; j < exist.size(); j++) {
+    vecRecorded.assign(exist.size(), 0); /* several found objects can match one track, only the first is recorded */
+    
+    // add currently found objects to the existing objects
+    for (unsigned int i = 0; i < found.size(); i++) {
+        
+        isnew = true;
+        
+        for (unsigned int j = 0; j < exist.size(); j++) {
 
-                    if (found[i].x >= (exist[j].x - exist[j].cm) && found[i].x <= (exist[j].x + exist[j].cm)) {
-                        if (found[i].y >= (exist[j].y - exist[j].cm) && found[i].y <= (exist[j].y + exist[j].cm)) {
+            if (found[i].x >= (exist.x[j] - exist.cm[j]) && found[i].x <= (exist.x[j] + exist.cm[j])) {
+                if (found[i].y >= (exist.y[j] - exist.cm[j]) && found[i].y <= (exist.y[j] + exist.cm[j])) {
+            
+                    isnew = false;
+                    if (iObjMove == ENABLED) {
+                        exist.x[j] = found[i].x; 
+                        exist.y[j] = found[i].y; 
+                    }
                     
-                            isnew = false;
-                            if (iObjMove == ENABLED) {
-                                exist[j].x = found[i].x; 
-                                exist[j].y = found[i].y; 
-                            }
-
-                            break;
-                        }
+                    if (!vecRecorded[j]) {
+                        exist.Record(j, frame_time, found[i].x, found[i].y, found[i].area);
+                        vecRecorded[j] = 1;
                     }
-                }
 
-                // is a new object, add to existing objects
-                if (isnew){ 
-                    
-                    IDcounter++;
-                    found[i].index = IDcounter;
-                    
-                    exist.push_back (found[i]);
+                    break;
                 }
             }
         }
-    }
-    else {
-        if (!found.empty()) exist = found; 
+
+        // is a new object, add to existing objects
+        if (isnew){ 
+            
+            TrackStore::Handle h = exist.Insert(IDcounter + 1, found[i].x, found[i].y, found[i].area, cfg->p.rmdefault, cfg->p.hsv);
+            
+            if (h.slot != INVALID_SLOT) { /* refused when the store is full */
+                IDcounter++;
+                exist.Record(exist.Find(h), frame_time, found[i].x, found[i].y, found[i].area);
+                vecRecorded.push_back(1); /* new tracks are appended, so this stays in step with exist */
+            }
+        }
     }
 
-    // return size of vecExistingObjects
+    // return amount of existing objects
     return exist.size();
 }
 
-void ColourTracking::ExistentialObjects(std::vector<Object> found, std::vector<Object>& exist)
+void ColourTracking::ExistentialObjects(const std::vector<Object>& found, TrackStore& exist)
 {
-    bool addrm;
     unsigned int i, j;
     
     // if object has not been detected for too long, start decreasing rm_counter
     // when it reaches zero or below, the object will be deleted during cleanup
-    if (!exist.empty()){
+    for (i = 0; i < exist.size(); i++){
         
-        if (!found.empty()){
-            for (i = 0; i < exist.size(); i++){
-                
-                addrm = false;
-                
-                for (j = 0; j < found.size(); j++){
-                    if (FitMargin(exist[i].x, exist[i].y, found[j].x, found[j].y, found[j].cm)) {
-                        if (exist[i].lifecnt < MinLife) exist[i].lifecnt++;
-                        break;
-                    }
-                    
-                }
-
-                if (j == found.size() && !FitMargin(exist[i].x, exist[i].y, found[j].x, found[j].y, found[j].cm))
-                    addrm = true;
-                    
-                if (addrm) exist[i].removcnt--;
-            }
+        for (j = 0; j < found.size(); j++){
+            if (FitMargin(exist.x[i], exist.y[i], found[j].x, found[j].y, found[j].cm)) break;
         }
-        else {
-            for (i = 0; i < exist.size(); i++){  // if no objects are found at all
-                exist[i].removcnt--;
-            }
+
+        if (j < found.size()) {
+            if (exist.lifecnt[i] < MinLife) exist.lifecnt[i]++;
         }
+        else exist.removcnt[i]--; /* not found this cycle (or no objects found at all) */
     }
 }
 
@@ -187,49 +366,87 @@ bool ColourTracking::FitMargin(int ax, int ay, int bx, int by, float cm)
     else return false;
 }
 
-unsigned int ColourTracking::CleanupObjects(std::vector<Object>& exist)
+unsigned int ColourTracking::CleanupObjects(TrackStore& exist)
 {   
+    // remove objects that no longer exist
+    if (!exist.empty()) exist.RemoveExpired();
+    
+    exist.InsertionOrder(vecOrder); /* tracks are listed in the order they appeared */
+    
     if (!exist.empty()) {
-        // remove objects that no longer exist
-        exist.erase(std::remove_if(exist.begin(), exist.end(),
-                     [](const Object & o) { return o.removcnt == 0; } ), exist.end());
         
         if (iDebugLevel == 2) {
-            std::cout << ts() << " Amount: " << exist.size() << std::endl;
-            for (unsigned int i = 0; i < exist.size(); i++){
-                std::cout << ts() << " Ind:" << exist[i].index << " x:" << exist[i].x << " y:" << exist[i].y << " rm:" << exist[i].removcnt << " life:" << exist[i].lifecnt << std::endl;
-                std::cout << ts() << " Colour range of [" << exist[i].index << "] : H[" << exist[i].lhue << "-" << exist[i].hhue << "]";
-                std::cout << " S[" << exist[i].lsat << "-" << exist[i].hsat << "]";
-                std::cout << " V[" << exist[i].lval << "-" << exist[i].hval << "]";
+            // records only, DebugLog formats them on its own thread
+            int32_t amount[2] = { (int32_t) exist.size(), (int32_t) exist.overflows() };
+            dlDebug.Log(debuglog::TRACK_AMOUNT, uiFrameNr, frame_time, amount, 2);
+            
+            vecLogRows.resize(vecOrder.size() * 11);
+            
+            for (unsigned int k = 0; k < vecOrder.size(); k++){
+                unsigned int i = vecOrder[k];
+                const int* hsv = exist.hsv(i);
+                int32_t* v = &vecLogRows[k * 11];
+                v[0] = exist.id(i); v[1] = exist.x[i]; v[2] = exist.y[i]; v[3] = exist.removcnt[i]; v[4] = exist.lifecnt[i];
+                memcpy(v + 5, hsv, 6 * sizeof(int32_t));
             }
+            
+            dlDebug.LogRows(debuglog::TRACK_STATE, uiFrameNr, frame_time, vecLogRows.data(), vecOrder.size(), 11); /* one record for all tracks */
         }
     }
     
-    // return size of vecExistingObjects
+    // return amount of existing objects
     return exist.size();
 }
 /**********************************************************************/
 
 
 /*** Functions regarding information transmission via socket | UDP ****/
-void ColourTracking::SetupSocket()
+bool ColourTracking::SetupSocket()
 {
-    sockfd = socket(AF_INET, SOCK_DGRAM, COMM_PROTOCOL);
+    int fd = socket(AF_INET, SOCK_DGRAM, COMM_PROTOCOL);
+    
+    if (fd < 0) {
+        sSocketError = std::string("Could not create UDP socket: ") + strerror(errno);
+        return false;
+    }
     
     bzero((char *) &server_addr, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = INADDR_ANY;
     server_addr.sin_port = htons(comm_port);
-    bind(sockfd, (struct sockaddr *) &server_addr, sizeof(server_addr));
+    
+    if (bind(fd, (struct sockaddr *) &server_addr, sizeof(server_addr)) < 0) {
+        sSocketError = "Could not bind UDP port " + std::to_string(comm_port) + ": " + strerror(errno);
+        close(fd);
+        return false;
+    }
+    
+    sockfd = fd;
+    
+    return true;
 }
 
-void ColourTracking::WriteSendBuffer(std::vector<Object> obj, char* send)
+void ColourTracking::SocketThread()
+{
+    bSocketOK = SetupSocket();
+    
+    if (bSocketOK) stStartup.Mark("socket");
+}
+
+void ColourTracking::WriteSendBuffer(const TrackStore& obj, char* send)
 {
     unsigned int k = 0;
+    unsigned int n = obj.size();
+    const unsigned int* life = obj.lifecnt.data();
 
-    for (unsigned int i = 0; i < obj.size(); i++) {
+    for (unsigned int i = 0; i < n; i++) {
 
-        if (obj[i].lifecnt >= MinLife) k++; // real object amount 
+        k += (life[i] >= MinLife); // real object amount 
+    }
+    
+    if (k > 0 && !bFirstObject) { /* resumed tracks make this the first frame */
+        bFirstObject = true;
+        std::cout << ts() << " First object reported " << (int) stStartup.now() << "ms after start\n";
     }
 
     bzero(send, 2048); /* flush send buffer */
@@ -246,14 +463,20 @@ void ColourTracking::WriteSendBuffer(std::vector<Object> obj, char* send)
         
         strcat(send, "\n");
         
-        for (unsigned int i = 0; i < obj.size(); i++){
+        vecLogRows.clear();
+        
+        for (unsigned int k = 0; k < n; k++){
+            
+            unsigned int i = vecOrder[k]; /* insertion order, filled by CleanupObjects */
             
-            if (obj[i].lifecnt >= MinLife) {
+            if (life[i] >= MinLife) {
+                
+                if (strlen(send) > 2048 - 64) break; /* no room left for another line */
 
-                std::string ind = std::to_string(obj[i].index); /* convert object index to string */
-                std::string x = std::to_string(obj[i].x); /* convert x coord to string */
-                std::string y = std::to_string(obj[i].y); /* convert y coordinate to string */
-                std::string s = std::to_string((int) obj[i].area); /* convert area to string */
+                std::string ind = std::to_string(obj.id(i)); /* convert object index to string */
+                std::string x = std::to_string(obj.x[i]); /* convert x coord to string */
+                std::string y = std::to_string(obj.y[i]); /* convert y coordinate to string */
+                std::string s = std::to_string(obj.area[i]); /* convert area to string */
                 
                 strcat(send, "<i>");
                 strncat(send, ind.c_str(), ind.size());  /* append object index */
@@ -268,30 +491,149 @@ void ColourTracking::WriteSendBuffer(std::vector<Object> obj, char* send)
                 strncat(send, s.c_str(), s.size());  /* append area value of object */
                 
                 strcat(send, "\n"); /* append endline for each object */
+                
+                if (iDebugLevel == 3) {
+                    int32_t v[4] = { (int32_t) obj.id(i), obj.x[i], obj.y[i], obj.area[i] };
+                    vecLogRows.insert(vecLogRows.end(), v, v + 4);
+                }
             }
         
         }
         strcat(send, "\0");
+        
+        if (iDebugLevel == 3) dlDebug.LogRows(debuglog::SEND_OBJECT, uiFrameNr, frame_time, vecLogRows.data(), vecLogRows.size() / 4, 4);
     }
     else strcpy(send, "<start>NOT_COUNTING<end>\n");
     
     if (iDebugLevel == 3){
-        std::cout << ts() << " Sending:\n" << send;
-        std::cout << "\n" << ts() << "send length: " << strlen(send) << std::endl;
+        int32_t v[2] = { (int32_t) k, (int32_t) strlen(send) }; /* follows the objects, the formatter prints it after them */
+        dlDebug.Log(debuglog::SEND_HEADER, uiFrameNr, frame_time, v, 2);
+    }
+}
+    
+void ColourTracking::WriteHistory(const TrackStore& obj, unsigned int id, unsigned int from, std::string& send)
+{
+    int i = obj.FindId(id);
+    
+    if (i < 0) {
+        send = "<start>UNKNOWN_ID<end>\n";
+        return;
+    }
+    
+    unsigned int n = obj.historySize(i);
+    unsigned int k = std::min(from, n);
+    
+    send = "<time>" + ts(); /* same header as the object list */
+    send += "<i>" + std::to_string(id);
+    send += "<nr>" + std::to_string(n);
+    send += "<from>" + std::to_string(k) + "\n";
+    
+    std::string line;
+    
+    for (; k < n; k++) { /* oldest position first */
+        
+        const TrackStore::HistoryPoint& p = obj.historyAt(i, k);
+        
+        line = "<t>" + std::to_string(p.t);
+        line += "<x>" + std::to_string(p.x);
+        line += "<y>" + std::to_string(p.y);
+        line += "<S>" + std::to_string(p.area) + "\n";
+        
+        if (send.size() + line.size() > COMM_HISTORY_BYTES) break; /* the client asks again from k */
+        
+        send += line;
+    }
+}
+    
+void ColourTracking::Control(const char* cmd, std::string& reply)
+{
+    char verb[16], param[16] = "";
+    int a = 0, b = 0;
+    
+    /* "set <param> <value> [value]" */
+    int n = sscanf(cmd, " %15s %15s %d %d", verb, param, &a, &b);
+    
+    if (n < 3 || strcmp(verb, COMM_SET)) {
+        reply = "<start>ERROR unknown command<end>\n";
+        return;
+    }
+    
+    bool range = (n == 4);
+    
+    if (!strcmp(param, "hue") && range && a >= 0 && a <= 179 && b >= 0 && b <= 179) {
+        iHSV[0] = a;
+        iHSV[1] = b;
+    }
+    else if (!strcmp(param, "sat") && range && a >= 0 && a <= 255 && b >= 0 && b <= 255) {
+        iHSV[2] = a;
+        iHSV[3] = b;
+    }
+    else if (!strcmp(param, "val") && range && a >= 0 && a <= 255 && b >= 0 && b <= 255) {
+        iHSV[4] = a;
+        iHSV[5] = b;
+    }
+    else if (!strcmp(param, "size") && range && a >= 0 && b <= 250000 && a <= b) {
+        ObjectMinsize = a;
+        ObjectMaxsize = b;
+    }
+    else if (!strcmp(param, "morph") && a >= 0 && a <= 2) {
+        iMorphLevel = a;
+    }
+    else if (!strcmp(param, "blur") && (a == 0 || a == 1)) {
+        bThreshBlur = a;
+    }
+    else if (!strcmp(param, "rmstart") && a >= 5 && a <= 50) {
+        rm_default = a;
+    }
+    else {
+        reply = "<start>ERROR bad parameter or value<end>\n";
+        return;
+    }
+    
+    /* applied from the next frame, see UpdateConfig() */
+    reply = "<start>OK<end>\n";
+    
+    if (iDebugLevel > 0 && DebugLogOn()) { /* formatted on the log thread, not here on the frame thread */
+        int32_t v[7] = { 0, 0, 0, 0, a, b, range ? 2 : 1 };
+        memcpy(v, param, sizeof(param)); /* name packed into the first four values */
+        dlDebug.Log(debuglog::CONTROL_SET, uiFrameNr, frame_time, v, 7);
     }
 }
     
 void ColourTracking::RecvSend(char* pass, char* send)
 {       
-    bzero(pass,64); /* flush pass buffer */
+    if (sockfd < 0) return; /* bench, or Ready() wasn't reached */
+    
+    bzero(pass, sizeof(CommPassBuffer)); /* flush pass buffer */
     clientlen = sizeof(client_addr);
     
-    recvfrom(sockfd, pass, 64, MSG_DONTWAIT, (struct sockaddr *)&client_addr, &clientlen);
+    recvfrom(sockfd, pass, sizeof(CommPassBuffer) - 1, MSG_DONTWAIT, (struct sockaddr *)&client_addr, &clientlen);
 
     if (!strcmp(pass,comm_pass)){
 
         sendto(sockfd, send, strlen(send), 0, (struct sockaddr *) &client_addr, sizeof(client_addr));
     }
+    else if (ctrl_pass[0] != '\0' && !strncmp(pass, ctrl_pass, strlen(ctrl_pass)) && pass[strlen(ctrl_pass)] == ' ') {
+        
+        std::string reply;
+        Control(pass + strlen(ctrl_pass), reply);
+        
+        sendto(sockfd, reply.c_str(), reply.size(), 0, (struct sockaddr *) &client_addr, sizeof(client_addr));
+    }
+    else if (!strncmp(pass, comm_pass, strlen(comm_pass)) && pass[strlen(comm_pass)] == ' ') {
+        
+        char cmd[16];
+        unsigned int id, from = 0;
+        
+        /* "<pass> history <id> [from]" */
+        if (sscanf(pass + strlen(comm_pass), " %15s %u %u", cmd, &id, &from) >= 2 && !strcmp(cmd, COMM_HISTORY)) {
+            
+            std::string hist;
+            WriteHistory(tsExistingObjects, id, from, hist);
+            
+            sendto(sockfd, hist.c_str(), hist.size(), 0, (struct sockaddr *) &client_addr, sizeof(client_addr));
+        }
+    }
 } 
 /**********************************************************************/
 
@@ -330,8 +672,117 @@ unsigned int ColourTracking::delay()
 /**********************************************************************/
 
 
+/*************** Functions regarding run-time configuration ***********/
+TrackerParams ColourTracking::StagedParams()
+{
+    TrackerParams p;
+    
+    for (int i = 0; i < 6; i++) p.hsv[i] = iHSV[i];
+    p.minsize = ObjectMinsize;
+    p.maxsize = ObjectMaxsize;
+    p.morph = iMorphLevel;
+    p.blur = bThreshBlur;
+    p.rmdefault = rm_default;
+    p.format = iInputFormat;
+    
+    return p;
+}
+
+void ColourTracking::UpdateConfig()
+{
+    TrackerParams staged = StagedParams();
+    std::shared_ptr<const TrackerConfig> prev = cfg;
+    
+    if (!cfg) { /* first frame has nothing to fall back on */
+        
+        cfg = cbConfig.Wait(); /* requested by Warmup(), built while the camera opened */
+        
+        if (!cfg) {
+            cfg = ConfigBuilder::BuildNow(staged, NULL);
+            pmRequested = staged;
+        }
+        stStartup.Mark("config");
+    }
+    
+    if (staged != pmRequested) {
+        cbConfig.Request(staged); /* built in the background, frame goes on with the old config */
+        pmRequested = staged;
+    }
+    
+    std::shared_ptr<const TrackerConfig> next = cbConfig.Take();
+    
+    if (next) cfg = next;
+    
+    // old snapshot is freed and the YUV table kept for the next start on the builder thread
+    if (cfg != prev) cbConfig.Adopted(cfg, std::move(prev));
+}
+
+bool ColourTracking::DebugLogOn()
+{
+    if (dlDebug.isRunning()) return true;
+    
+    if (!dlDebug.Start(sLogFile.empty() ? NULL : sLogFile.c_str())) {
+        std::cout << ts() << " Could not open log file " << sLogFile << ", debug output goes to stdout.\n";
+        sLogFile.clear();
+        return dlDebug.Start(NULL);
+    }
+    
+    return true;
+}
+
+bool ColourTracking::Warmup()
+{
+    TrackerParams staged = StagedParams();
+    const unsigned char* table = NULL;
+    
+    if (!sStateFile.empty()) {
+        
+        if (!sfState.Open(sStateFile.c_str())) {
+            std::cout << ts() << " Could not open state file " << sStateFile << ".\n";
+            return false;
+        }
+        
+        cbConfig.SaveTables(&sfState);
+        
+        int64_t now = duration_cast<milliseconds> (system_clock::now().time_since_epoch()).count();
+        
+        if (sfState.Restore(now, uiCaptureWidth, uiCaptureHeight, tsExistingObjects, IDcounter)) {
+            std::cout << ts() << " Resumed " << tsExistingObjects.size() << " objects from " << sStateFile << "\n";
+            stStartup.Mark("state");
+        }
+        
+        table = sfState.Table(staged.hsv);
+    }
+    
+    thSocket = std::thread(&ColourTracking::SocketThread, this);
+    
+    // only a YUV table takes long to build, that happens in the background while the camera opens
+    if (staged.format == INPUT_BGR || table != NULL) {
+        cfg = ConfigBuilder::BuildNow(staged, table);
+        stStartup.Mark("config");
+    }
+    else cbConfig.Request(staged);
+    
+    pmRequested = staged;
+    bStartupReport = true;
+    bFirstObject = false;
+    
+    return true;
+}
+
+bool ColourTracking::Ready()
+{
+    if (thSocket.joinable()) thSocket.join();
+    
+    if (!bSocketOK) std::cout << ts() << " " << sSocketError << ". Exiting..\n";
+    
+    return bSocketOK;
+}
+/**********************************************************************/
+
+
 /****** OpenCV-based functions (using functionality of imgproc) *******/
-void ColourTracking::ThresholdImage(cv::Mat src, cv::Mat& dst, int hsv[], bool blur)
+void ColourTracking::ThresholdImage(cv::Mat src, cv::Mat& dst, const int hsv[], bool blur)
 {
     // container for HSV image
     cv::Mat buf;
@@ -353,40 +804,157 @@ void ColourTracking::ThresholdImage(cv::Mat src, cv::Mat& dst, int hsv[], bool b
     }
 }    
 
-void ColourTracking::MorphImage(unsigned int morph, int size, cv::Mat src, cv::Mat& dst)
+void ColourTracking::ThresholdFrame(cv::Rect roi, int step, cv::Mat& dst, TileMap* tiles)
+{
+    if (iInputFormat != INPUT_BGR) {
+        ThresholdYUV(imgYUV, roi, step, dst, tiles);
+        return;
+    }
+    
+    cv::Mat src = imgOriginal(roi);
+    
+    if (step > 1) {
+        cv::Mat small; /* reduced copy for the coarse pyramid pass */
+        cv::resize(src, small, cv::Size(roi.width / step, roi.height / step), 0, 0, INTER_AREA);
+        src = small;
+        tiles = NULL;
+    }
+    
+    if (bGeneric) {
+        ThresholdImage(src, dst, cfg->p.hsv, cfg->p.blur);
+        if (tiles != NULL) {
+            for (int j = 0; j < dst.rows; j++) tiles->MarkRow(j, dst.ptr<uchar>(j));
+        }
+        return;
+    }
+    
+    cfg->thresholdKernel(src, dst, cfg->p.hsv, tiles); /* specialised for the config, marks tiles band by band */
+}
+
+void ColourTracking::ThresholdYUV(const cv::Mat& src, cv::Rect roi, int step, cv::Mat& dst, TileMap* tiles)
+{
+    const TrackerConfig& c = *cfg;
+    int height = FrameSize().height;
+    
+    // no colour conversion at all: every pixel is one lookup in the table built with the config
+    dst.create(roi.height / step, roi.width / step, CV_8U);
+    
+    for (int j = 0; j < dst.rows; j++) {
+        
+        int y = roi.y + j * step;
+        uchar* d = dst.ptr<uchar>(j);
+        
+        if (iInputFormat == INPUT_YUYV) {
+            const uchar* p = src.ptr<uchar>(y); /* Y0 U Y1 V */
+            for (int i = 0; i < dst.cols; i++) {
+                int x = roi.x + i * step;
+                const uchar* pair = p + 4 * (x >> 1);
+                d[i] = c.yuvMatch(p[2 * x], pair[1], pair[3]) ? 255 : 0;
+            }
+        }
+        else {
+            const uchar* py = src.ptr<uchar>(y);
+            const uchar* puv = src.ptr<uchar>(height + (y >> 1)); /* U V at half resolution */
+            for (int i = 0; i < dst.cols; i++) {
+                int x = roi.x + i * step;
+                const uchar* uv = puv + (x & ~1);
+                d[i] = c.yuvMatch(py[x], uv[0], uv[1]) ? 255 : 0;
+            }
+        }
+        
+        if (tiles != NULL) tiles->MarkRow(j, d);
+    }
+}
+
+void ColourTracking::PrepareYUV()
+{
+    if (!cfg->p.blur) {
+        imgYUV = imgRaw;
+        return;
+    }
+    
+    cv::Size size = FrameSize();
+    
+    // blur the YUV samples instead of the HSV image, chroma is blurred at its own (half) resolution
+    if (iInputFormat == INPUT_YUYV) {
+        cv::Mat pairs(size.height, size.width / 2, CV_8UC4, imgRaw.data, imgRaw.step); /* Y0 U Y1 V as one pixel */
+        cv::Mat blurred;
+        cv::GaussianBlur(pairs, blurred, cv::Size(5,5), 0,0);
+        imgYUV = blurred.reshape(2, size.height);
+    }
+    else {
+        imgYUV.create(imgRaw.size(), imgRaw.type());
+        
+        cv::Mat ySrc = imgRaw.rowRange(0, size.height), yDst = imgYUV.rowRange(0, size.height);
+        cv::Mat uvSrc(size.height / 2, size.width / 2, CV_8UC2, imgRaw.ptr<uchar>(size.height), imgRaw.step);
+        cv::Mat uvDst(size.height / 2, size.width / 2, CV_8UC2, imgYUV.ptr<uchar>(size.height), imgYUV.step);
+        
+        cv::GaussianBlur(ySrc, yDst, cv::Size(5,5), 0,0);
+        cv::GaussianBlur(uvSrc, uvDst, cv::Size(5,5), 0,0);
+    }
+}
+
+int ColourTracking::RawConversion() const
+{
+    return (iInputFormat == INPUT_YUYV) ? cv::COLOR_YUV2BGR_YUYV : cv::COLOR_YUV2BGR_NV12;
+}
+
+void ColourTracking::RawToBGR()
+{
+    cv::cvtColor(imgRaw, imgOriginal, RawConversion());
+}
+
+cv::Size ColourTracking::FrameSize()
+{
+    if (iInputFormat == INPUT_BGR) return imgOriginal.size();
+    if (iInputFormat == INPUT_YUYV) return imgRaw.size();
+    
+    return cv::Size(imgRaw.cols, imgRaw.rows * 2 / 3);
+}
+
+bool ColourTracking::RawLayout()
+{
+    unsigned int bytes = uiCaptureWidth * uiCaptureHeight * 2;
+    
+    // drivers hand out unconverted frames as one row of bytes
+    if (imgRaw.empty() || !imgRaw.isContinuous() || imgRaw.total() * imgRaw.elemSize() != bytes) return false;
+    
+    imgRaw = imgRaw.reshape(2, uiCaptureHeight);
+    
+    return true;
+}
+
+void ColourTracking::MorphImage(unsigned int morph, const cv::Mat& kernel, cv::Mat src, cv::Mat& dst)
 {
     cv::Mat buf = src; /* buffer Mat on which to use erode and dilate */
     
-    if (morph > 0) cv::erode(buf, buf, cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(size, size)));
-    if (morph > 1) cv::dilate(buf, buf, cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(size, size)));    
-    if (morph > 1) cv::dilate(buf, buf, cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(size, size)));
-    if (morph > 0) cv::erode(buf, buf, cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(size, size)));
+    if (morph > 0) cv::erode(buf, buf, kernel);
+    if (morph > 1) cv::dilate(buf, buf, kernel);    
+    if (morph > 1) cv::dilate(buf, buf, kernel);
+    if (morph > 0) cv::erode(buf, buf, kernel);
     
     dst = buf;
 }    
+
+void ColourTracking::MorphFrame(cv::Mat src, cv::Mat& dst)
+{
+    if (!bGeneric && cfg->morphKernel != NULL) cfg->morphKernel(src, dst); /* fused steps, see PixelKernels.hpp */
+    else MorphImage(cfg->p.morph, cfg->kernel, src, dst);
+}
    
-void ColourTracking::DrawCircles(cv::Mat src, cv::Mat& dst, std::vector<Object> obj)
+void ColourTracking::CollectOverlay(const TrackStore& obj, std::vector<PreviewStream::Circle>& circles)
 {
-    dst = cv::Mat::zeros(src.size(), src.type());
-    float rad;
+    circles.clear();
     
-    if (!obj.empty()) {
-        for (unsigned int i=0; i<obj.size(); i++) {
+    for (unsigned int i=0; i<obj.size(); i++) {
+         
+        if (obj.lifecnt[i] >= MinLife) {
              
-            if (obj[i].lifecnt >= MinLife) {
-                 
-                // circle area = pi * radius^2
-                rad = sqrt(obj[i].area/PI_VALUE);
-                cv::circle(dst,cv::Point(obj[i].x,obj[i].y), rad, cv::Scalar(0,0,255), 2, 8, 0);
-
-                if (iDebugLevel > 0) cv::circle(dst,cv::Point(obj[i].x,obj[i].y), 3, cv::Scalar(0,255,0), 2, 8, 0); // draw mass center
-            }
+            // circle area = pi * radius^2
+            PreviewStream::Circle c = { obj.x[i], obj.y[i], (int) sqrt(obj.area[i]/PI_VALUE), iDebugLevel > 0 };
+            circles.push_back(c);
         }
     }
-
-    if (imgOriginal.size() == imgCircles.size()) {
-            imgOriginal = imgOriginal + imgCircles;       /* add drawn circles to original */
-    }
 }
 /**********************************************************************/
 
@@ -396,6 +964,8 @@ void ColourTracking::Display()
 //    std::cout << "at display\n";
 
     if (bGUI && iShowThresh == ENABLED) {
+        
+        bWindowThresh = true;
 
         //imshow("Thresholded Image", imgThresh); /* show the thresholded image */
         if (ResizeImages) {
@@ -407,10 +977,16 @@ void ColourTracking::Display()
              imshow("Thresholded Image", imgThresh);
         }
         
-    }else destroyWindow("Thresholded Image");
+    }
+    else if (bWindowThresh) {
+        destroyWindow("Thresholded Image");
+        bWindowThresh = false;
+    }
     
     if (bGUI && iShowOriginal == ENABLED) {
         
+        bWindowOriginal = true;
+        
         if (ResizeImages) {
             cv::Mat rsOrig;
             cv::resize(imgOriginal, rsOrig, cv::Size(uiFrameWidth, uiFrameHeight), 0, 0, INTER_AREA);
@@ -420,7 +996,11 @@ void ColourTracking::Display()
             imshow("Original", imgOriginal); /* show the original image */
         }
         
-    }else destroyWindow("Original");
+    }
+    else if (bWindowOriginal) {
+        destroyWindow("Original");
+        bWindowOriginal = false;
+    }
 }
 
 std::string ColourTracking::ts()
@@ -488,9 +1068,26 @@ int ColourTracking::CmdParameters(int argc, char** argv)
                 std::cout << "-morph # (0..2)\n-nocount (Not recommended for commandline)\n";
                 std::cout << "-udppass [string]  (passphrase that udp client needs to provide)\n";
                 std::cout << "-udpport [port nr]  (port nr for udp communication, 2000..65535)\n";
+                std::cout << "-ctrlpass [string]  Enables run-time control over udp: \"<ctrlpass> set hue|sat|val|size min max\",\n";
+                std::cout << "                    \"<ctrlpass> set morph|blur|rmstart value\". Disabled when not given, must differ from -udppass.\n";
                 std::cout << "-rmstart [5..50]  defines how many cycles before object is dropped\n";
                 std::cout << "-drawmin [0..500] (Default is 30) Defines how many cycles an object must exist, before it is marked on the original frame.\n";
                 std::cout << "-noblur   Disables blurring before thresholding the HSV image.\n";
+                std::cout << "-maxtracks [1..4096] (Default is 256) How many objects can be tracked at once, new ones are ignored when full.\n";
+                std::cout << "-preview [port] Serves a JPEG preview on http://127.0.0.1:port/ (for -nogui nodes).\n";
+                std::cout << "-previewfps [1..10] (Default is 2) Maximum preview rate.\n";
+                std::cout << "-previewwidth [64..1024] (Default is 320) Width of preview images.\n";
+                std::cout << "-tracklog [file] Records tracked objects of every frame to a binary file (see TrackLog.hpp), appends after a restart.\n";
+                std::cout << "-history [1..1024] (Default is 32) How many past positions are kept per object (udp: \"<pass> history <id> [from]\",\n";
+                std::cout << "                   a reply holds at most " << COMM_HISTORY_BYTES << " bytes, <from> and <nr> tell where to continue).\n";
+                std::cout << "-pyramid # (0..2) Finds objects on a 1/2 (1) or 1/4 (2) scale frame, measures them at full resolution.\n";
+                std::cout << "-logfile [file] Appends debug output (-debug 2, 3) to a file instead of stdout, keeps 4 rotated files.\n";
+                std::cout << "-statefile [file] Saves tracks every frame, a restart within 30 s resumes them without re-confirming.\n";
+                std::cout << "-notiles  Morphs and searches the whole mask instead of only its occupied 32x32 tiles.\n";
+                std::cout << "-generic  Thresholds and morphs with cvtColor, inRange, erode & dilate instead of compile-time specialised kernels (compare with ./bench -generic).\n";
+                std::cout << "-yuv  Takes unconverted YUYV frames from the camera and thresholds them without converting to BGR.\n";
+                std::cout << "      The camera is only asked for YUYV, NV12 frames are read from files (-rawinput).\n";
+                std::cout << "-rawinput [file] yuyv|nv12  Reads raw frames of -capsize from a file instead of the camera.\n";
                 return -1;
             }
             else if (!std::strcmp(argv[j],"-capsize")){
@@ -564,15 +1161,37 @@ int ColourTracking::CmdParameters(int argc, char** argv)
                         return -1;
                     }
             }
+            else if (!std::strcmp(argv[j],"-pyramid")){
+                uiPyramid = std::atoi(argv[j+1]);
+                j++;
+                    if (uiPyramid > MAX_PYRAMID){
+                        std::cout << "Pyramid level can be set from 0 to 2.\n0 - full resolution, 1 - half scale, 2 - quarter scale\n";
+                        return -1;
+                    }
+            }
+            else if (!std::strcmp(argv[j],"-notiles")){
+                bSparse = DISABLED;
+            }
+            else if (!std::strcmp(argv[j],"-generic")){
+                bGeneric = ENABLED;
+            }
             else if (!std::strcmp(argv[j],"-nocount")){
                 iCount = 0;
             }
             else if (!std::strcmp(argv[j],"-udppass")){
-                std::strcpy(argv[j+1],comm_pass);
-                if (strlen(comm_pass) > 64) {
+                if (strlen(argv[j+1]) > 64) {
                     std::cout << "UDP pass too long. Maximum 64 symbols.\n";
                     return -1;
                 }
+                std::strcpy(comm_pass, argv[j+1]);
+                j++;
+            }
+            else if (!std::strcmp(argv[j],"-ctrlpass")){
+                if (strlen(argv[j+1]) > 64 || strlen(argv[j+1]) == 0) {
+                    std::cout << "Control pass must be 1..64 symbols.\n";
+                    return -1;
+                }
+                std::strcpy(ctrl_pass, argv[j+1]);
                 j++;
             }
             else if (!std::strcmp(argv[j],"-udpport")){
@@ -602,6 +1221,95 @@ int ColourTracking::CmdParameters(int argc, char** argv)
                 }
                 j++;
             }
+            else if (!std::strcmp(argv[j],"-maxtracks")){
+                int maxtracks = std::atoi(argv[j+1]);
+                if (maxtracks < 1 || maxtracks > MAX_TRACKS_LIMIT){
+                    std::cout << "Track capacity can be set between 1..4096.\n";
+                    return -1;
+                }
+                tsExistingObjects.Init(maxtracks, tsExistingObjects.depth());
+                j++;
+            }
+            else if (!std::strcmp(argv[j],"-history")){
+                int depth = std::atoi(argv[j+1]);
+                if (depth < 1 || depth > MAX_HISTORY_DEPTH){
+                    std::cout << "History depth can be set between 1..1024.\n";
+                    return -1;
+                }
+                tsExistingObjects.Init(tsExistingObjects.capacity(), depth);
+                j++;
+            }
+            else if (!std::strcmp(argv[j],"-preview")){
+                unsigned int port = std::atoi(argv[j+1]);
+                if (port < 2000 || port > 65535){
+                    std::cout << "Preview port must be between 2000 and 65535.\n";
+                    return -1;
+                }
+                if (!psPreview.Start(port)){
+                    std::cout << "Could not open preview port " << port << ".\n";
+                    return -1;
+                }
+                std::cout << ts() << " Preview on http://127.0.0.1:" << port << "/\n";
+                j++;
+            }
+            else if (!std::strcmp(argv[j],"-previewfps")){
+                int fps = std::atoi(argv[j+1]);
+                if (fps < 1 || fps > PREVIEW_MAX_FPS){
+                    std::cout << "Preview rate can be set between 1..10.\n";
+                    return -1;
+                }
+                psPreview.setRate(fps);
+                j++;
+            }
+            else if (!std::strcmp(argv[j],"-previewwidth")){
+                int width = std::atoi(argv[j+1]);
+                if (width < 64 || width > 1024){
+                    std::cout << "Preview width can be set between 64..1024.\n";
+                    return -1;
+                }
+                psPreview.setWidth(width);
+                j++;
+            }
+            else if (!std::strcmp(argv[j],"-tracklog")){
+                if (!tlTrackLog.Open(argv[j+1])){
+                    std::cout << "Could not create track log file " << argv[j+1] << ".\n";
+                    return -1;
+                }
+                std::cout << ts() << " Recording tracks to " << argv[j+1] << "\n";
+                j++;
+            }
+            else if (!std::strcmp(argv[j],"-yuv")){
+                iInputFormat = INPUT_YUYV;
+            }
+            else if (!std::strcmp(argv[j],"-rawinput")){
+                if (j + 2 >= argc) {
+                    std::cout << "Raw input needs a file and a format (yuyv or nv12).\n";
+                    return -1;
+                }
+                if (!std::strcmp(argv[j+2], "yuyv")) iInputFormat = INPUT_YUYV;
+                else if (!std::strcmp(argv[j+2], "nv12")) iInputFormat = INPUT_NV12;
+                else {
+                    std::cout << "Raw input format can be yuyv or nv12.\n";
+                    return -1;
+                }
+                sRawInput = argv[j+1];
+                j += 2;
+            }
+            else if (!std::strcmp(argv[j],"-logfile")){
+                FILE* f = fopen(argv[j+1], "a"); /* only checked here, opened when there is something to log */
+                if (f == NULL){
+                    std::cout << "Could not create log file " << argv[j+1] << ".\n";
+                    return -1;
+                }
+                fclose(f);
+                sLogFile = argv[j+1];
+                std::cout << ts() << " Debug output goes to " << argv[j+1] << " (rotated at 8 MB)\n";
+                j++;
+            }
+            else if (!std::strcmp(argv[j],"-statefile")){
+                sStateFile = argv[j+1]; /* opened by Warmup(), once -maxtracks is known */
+                j++;
+            }
             else if (!std::strcmp(argv[j],"-drawmin")){
                 MinLife = std::atoi(argv[j+1]);
                 if (MinLife > 500){
@@ -613,5 +1321,15 @@ int ColourTracking::CmdParameters(int argc, char** argv)
         }
     }
     
+    if (ctrl_pass[0] != '\0' && !strcmp(ctrl_pass, comm_pass)){
+        std::cout << "Control pass must differ from the UDP pass, every client that can read objects could change parameters.\n";
+        return -1;
+    }
+    
+    if (iInputFormat != INPUT_BGR && (uiCaptureHeight % 2 || uiCaptureWidth % 2)){
+        std::cout << "YUV input needs an even capture height and width.\n";
+        return -1;
+    }
+    
     return 1;
 }
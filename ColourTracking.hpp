@@ -11,6 +11,9 @@
 #define COMM_PORT 12015
 #define COMM_PROTOCOL 0 // UDP
 #define COMM_PASS "getobjectinfo"
+#define COMM_HISTORY "history" // "<pass> history <id> [from]" returns the recorded path of one object, from position [from] on
+#define COMM_HISTORY_BYTES 2048 // largest history reply, longer paths are sent in pages
+#define COMM_SET "set" // "<ctrlpass> set <param> <values>" changes parameters at run-time
 
 #define CAP_HEIGHT 256
 #define CAP_WIDTH 256
@@ -32,6 +35,12 @@
 #define DEFAULT 3
 #define DEF_DEBUG 1
 #define MORPH_KERNEL_SIZE 3
+#define MAX_PYRAMID 2 // coarse detection at 1/2 or 1/4 of capture resolution
+
+// layout of captured frames
+#define INPUT_BGR 0     // imgOriginal, converted by the camera driver
+#define INPUT_YUYV 1    // imgRaw, packed 4:2:2 (-yuv, -rawinput)
+#define INPUT_NV12 2    // imgRaw, Y plane + interleaved UV plane (-rawinput)
 
 // approximate high hues of colours
 #define ORANGE 22
@@ -42,19 +51,34 @@
 #define RED 179
 
 #include "opencv2/core/core.hpp"
+#include "TrackStore.hpp"
+#include "TrackLog.hpp"
+#include "PreviewStream.hpp"
+#include "TrackerConfig.hpp"
+#include "TileMap.hpp"
+#include "DebugLog.hpp"
+#include "StateFile.hpp"
+#include "StartupTrace.hpp"
 #include <chrono>
+#include <thread>
 
 #include <netinet/in.h>
 
 class ColourTracking
 {
+    friend class Bench; /* bench.cpp times the private stages */
+    
     /******************** Private access variables ********************/
     /***************** (e.g. configuration parameters) ****************/
     private:
     
     // Image pixel arrays
     cv::Mat imgThresh;
-    cv::Mat imgCircles;
+    cv::Mat imgYUV; /* imgRaw, or its blurred copy */
+    
+    // INPUT_BGR, INPUT_YUYV or INPUT_NV12; raw frame file (-rawinput)
+    int iInputFormat;
+    std::string sRawInput;
 
     // do counting; show unaltered image; show thresholded image; GUI; blur when thresh
     int iCount;
@@ -62,12 +86,27 @@ class ColourTracking
     int iShowThresh;
     bool bGUI;
     bool bThreshBlur;
+    
+    // which windows are currently open, so they're only destroyed once
+    bool bWindowOriginal;
+    bool bWindowThresh;
 
     // hue/saturation/light intensity values; morph level; debug level
     int iHSV[6];
     int iMorphLevel;
     int iDebugLevel;
     
+    // coarse-to-fine detection: 0 - full resolution, 1 - 1/2 scale, 2 - 1/4 scale
+    unsigned int uiPyramid;
+    
+    // morph and find objects only around occupied tiles of the mask (same result as the whole frame)
+    bool bSparse;
+    TileMap tmOccupied;
+    
+    // threshold and morph with cvtColor & inRange and erode & dilate instead of the specialised kernels (PixelKernels.hpp)
+    bool bGeneric;
+    std::vector<cv::Rect> vecRegions;
+    
     // main loop delay; captured frame height; captured frame width
     unsigned int uiDelay;
     unsigned int uiCaptureHeight;
@@ -82,6 +121,7 @@ class ColourTracking
     
     // parameters for use in UDP communication
     char comm_pass[256];
+    char ctrl_pass[256]; /* empty: run-time control disabled */
     unsigned int comm_port;
     //int objectamount;
     
@@ -89,12 +129,17 @@ class ColourTracking
     std::chrono::high_resolution_clock::time_point start_time;
     std::chrono::high_resolution_clock::time_point end_time;
     unsigned int time_dif;  
+    int64_t frame_time; /* capture time of current frame, ms since epoch */
+    unsigned int uiFrameNr; /* frames processed since start */
     
     // udp communication variables
-    int sockfd; /* socket file descriptor */
+    int sockfd; /* socket file descriptor, -1 until SetupSocket() succeeds */
+    std::thread thSocket; /* runs SetupSocket() while the camera opens */
+    bool bSocketOK;
+    std::string sSocketError;
     struct sockaddr_in server_addr, client_addr; /* server & client address */
     socklen_t clientlen; /* length of client address */
-    char CommPassBuffer[64]; /* message received from client */
+    char CommPassBuffer[128]; /* message received from client */
     char CommSendBuffer[2048]; /* message sent to client */
 
     
@@ -115,7 +160,7 @@ class ColourTracking
         int lval;
         int hval;
         
-        Object(unsigned int newindex, int newx, int newy, int newarea, int rmdef, int hsv[]) 
+        Object(unsigned int newindex, int newx, int newy, int newarea, int rmdef, const int hsv[]) 
         { 
             index = newindex;
             x = newx;
@@ -139,40 +184,103 @@ class ColourTracking
     unsigned int MinLife;
     int iObjMove;
     
-    std::vector<Object> vecExistingObjects;
+    TrackStore tsExistingObjects; /* tracked objects, see TrackStore.hpp */
+    TrackLogWriter tlTrackLog; /* binary recording of tracked objects (-tracklog) */
+    unsigned long ulTrackLogLoss; /* dropped + truncated frames already reported */
+    
+    StartupTrace stStartup; /* time from exec to first result (printed after the first frame) */
+    bool bStartupReport;
+    bool bFirstObject;
+    StateFile sfState; /* tracks and YUV table saved every frame, resumed after a restart (-statefile) */
+    std::string sStateFile;
+    
+    DebugLog dlDebug; /* debug level 2 and 3 output, formatted off the frame loop (-logfile) */
+    std::string sLogFile; /* empty: stdout */
+    
+    bool DebugLogOn(); /* starts dlDebug with the first record to log */
+    PreviewStream psPreview; /* JPEG preview for headless nodes (-preview) */
+    std::vector<PreviewStream::Circle> vecOverlay; /* circles of confirmed objects */
     std::vector<Object> vecFoundObjects;
+    std::vector<unsigned char> vecRecorded; /* per track, history already has an entry for this frame */
+    std::vector<unsigned int> vecOrder; /* dense positions of the tracks in insertion order, for output */
+    std::vector<int32_t> vecLogRows; /* values of a frame's per-object debug lines, logged with one LogRows() */
+    
+    // CLI, trackbars and UDP control only change the staged values above (iHSV, iMorphLevel..),
+    // frames are processed with an immutable snapshot that is swapped between frames
+    std::shared_ptr<const TrackerConfig> cfg; /* config of the current frame */
+    ConfigBuilder cbConfig; /* builds snapshots and their derived state in the background */
+    TrackerParams pmRequested; /* staged values last handed to cbConfig */
+    
+    TrackerParams StagedParams(); /* collect staged values */
+    void UpdateConfig(); /* request a new snapshot if needed, swap in a finished one */
     
     /******************** OpenCV-related and other ********************/
     /******************** private access functions ********************/
     
-    // threshold image with user defined parameters
-    void ThresholdImage(cv::Mat, cv::Mat&, int [], bool);
+    // threshold a whole image with user defined parameters (reference for the threshold kernels, see PixelKernels.hpp)
+    void ThresholdImage(cv::Mat, cv::Mat&, const int [], bool);
+    
+    // threshold YUV input with the lookup table of the config, every step'th pixel of roi
+    void ThresholdYUV(const cv::Mat&, cv::Rect, int, cv::Mat&, TileMap*);
+    
+    // threshold a region of the current frame, whatever its format; tiles are marked for whole frames only
+    void ThresholdFrame(cv::Rect, int, cv::Mat&, TileMap*);
+    
+    // blur YUV planes (if asked) before ThresholdYUV; convert to BGR for display
+    void PrepareYUV();
+    void RawToBGR();
+    int RawConversion() const; /* cvtColor code from the raw input format to BGR */
     
-    // erode & dilate binary image
-    void MorphImage(unsigned int, int, cv::Mat, cv::Mat&);
+    // size of the current frame in pixels
+    cv::Size FrameSize();
+    
+    // erode & dilate binary image (reference for the morph kernels)
+    void MorphImage(unsigned int, const cv::Mat&, cv::Mat, cv::Mat&);
+    
+    // morph a mask or a region of it with the current config, in place when src and dst are the same
+    void MorphFrame(cv::Mat, cv::Mat&);
     
     // create vectors for moments, areas and mass centers
     int FindObjects(cv::Mat, float, float, std::vector<Object>&); 
     
+    // same as FindObjects, but only inside regions of a mask that is zero everywhere else
+    int FindObjectsSparse(cv::Mat, const std::vector<cv::Rect>&, float, float, std::vector<Object>&);
+    
+    // find candidates on a downscaled frame, threshold and measure them at full resolution
+    int FindObjectsPyramid(cv::Size, unsigned int, float, float, std::vector<Object>&);
+    
+    // turn contours within size limits into objects
+    void ContoursToObjects(std::vector<std::vector<cv::Point> >&, float, float, std::vector<Object>&);
+    
     // work with object vectors
-    unsigned int AddNewObjects(std::vector<Object> found, std::vector<Object>& exist);
-    void ExistentialObjects(std::vector<Object> found, std::vector<Object>& exist);
-    unsigned int CleanupObjects(std::vector<Object>& exist);
+    unsigned int AddNewObjects(const std::vector<Object>& found, TrackStore& exist);
+    void ExistentialObjects(const std::vector<Object>& found, TrackStore& exist);
+    unsigned int CleanupObjects(TrackStore& exist);
     bool FitMargin(int ax, int ay, int bx, int by, float cm);
     
-    // draw circles around found objects
-    void DrawCircles(cv::Mat, cv::Mat&, std::vector<Object>);
+    // collect circles around confirmed objects, only called when something displays them
+    void CollectOverlay(const TrackStore&, std::vector<PreviewStream::Circle>&);
     
     // Information transmission via UDP
-    void SetupSocket();/* bind socket */
+    bool SetupSocket();/* bind socket, false (and sSocketError) on failure */
+    void SocketThread();
     void RecvSend(char*, char*); /* receive and send information back (if correct pass) */
-    void WriteSendBuffer(std::vector<Object>, char*); /* write useful information to buffer */ 
+    void WriteSendBuffer(const TrackStore&, char*); /* write useful information to buffer */ 
+    void WriteHistory(const TrackStore&, unsigned int, unsigned int, std::string&); /* write path of one object, starting at a position */
+    void Control(const char*, std::string&); /* change staged values, write reply */
      
     /******************** Public access variables *********************/
     /************************ and functions ***************************/
     public:
 
     cv::Mat imgOriginal; /* this Mat is public because it's used in main */
+    cv::Mat imgRaw; /* captured frame when the input is YUV, imgOriginal is only filled for display */
+    
+    int inputFormat() { return iInputFormat; }
+    
+    const std::string& rawInput() { return sRawInput; } /* empty: read from camera */
+    
+    bool RawLayout(); /* reshape a raw camera buffer into the YUYV layout, false if it doesn't fit */
 
     void setHSV (int *); /* set hue, saturation and light intensity*/
  
@@ -192,10 +300,16 @@ class ColourTracking
     {
         iCount = ENABLED;
         iMorphLevel = DISABLED;
+        uiPyramid = DISABLED;
+        bSparse = ENABLED;
+        bGeneric = DISABLED;
         iShowOriginal = DISABLED;
         iShowThresh = DISABLED;
         bGUI = ENABLED;
         bThreshBlur = ENABLED;
+        bWindowOriginal = false;
+        bWindowThresh = false;
+        iInputFormat = INPUT_BGR;
         
         int buffer[6] = {LHUE, HHUE, LSAT, HSAT, LVAL, HVAL};
         setHSV(buffer);
@@ -213,15 +327,38 @@ class ColourTracking
         ObjectMaxsize = (uiCaptureHeight * uiCaptureWidth) / 4;
         
         strncpy(comm_pass, COMM_PASS, sizeof(COMM_PASS));
+        ctrl_pass[0] = '\0';
         comm_port = COMM_PORT;
         
+        IDcounter = 0;
+        uiFrameNr = 0;
         rm_default = 5;
         MinLife = rm_default * 2; // default is always higher than removal counter
         iObjMove = ENABLED;
+        ulTrackLogLoss = 0;
         
-        SetupSocket();
+        sockfd = -1; /* socket is set up by Warmup() */
+        bSocketOK = false;
+        bStartupReport = false;
+        bFirstObject = true; /* nothing is reported about startup unless Warmup() runs */
+        
+        cbConfig.Start();
     }
         
+    ~ColourTracking()
+    {
+        if (thSocket.joinable()) thSocket.join();
+    }
+    
+    // start what doesn't need the camera (socket, first config, saved state), call after CmdParameters
+    bool Warmup();
+    
+    // wait for Warmup(), false if the socket couldn't be set up
+    bool Ready();
+    
+    // startup milestone, e.g. "camera"
+    void Milestone(const char* what) { stStartup.Mark(what); }
+    
     void Process();
     
     // display original and thresholded images
@@ -0,0 +1,329 @@
+/*
+ * File name: DebugLog.cpp
+ * File description: Implementation of DebugLog class.
+ *
+ */
+
+#include "DebugLog.hpp"
+
+#include <ctime>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <algorithm>
+
+using namespace debuglog;
+
+// ring of the calling thread, valid while ringSerial matches the running log
+static std::atomic<unsigned int> serials(0);
+static thread_local unsigned int ringSerial = 0;
+static thread_local Ring* ringCached = NULL;
+
+// LogRows() payload: raw bytes in the slots from position at on, wrapping at the end of the ring
+static void CopyIn(Ring* ring, uint32_t at, const void* data, size_t bytes)
+{
+    uint32_t i = at & (DEBUGLOG_RING - 1);
+    size_t first = std::min(bytes, (DEBUGLOG_RING - i) * sizeof(Record));
+
+    memcpy(&ring->slot[i], data, first);
+    memcpy(&ring->slot[0], (const char*) data + first, bytes - first);
+}
+
+static void CopyOut(const Ring* ring, uint32_t at, void* data, size_t bytes)
+{
+    uint32_t i = at & (DEBUGLOG_RING - 1);
+    size_t first = std::min(bytes, (DEBUGLOG_RING - i) * sizeof(Record));
+
+    memcpy(data, &ring->slot[i], first);
+    memcpy((char*) data + first, &ring->slot[0], bytes - first);
+}
+
+bool DebugLog::Start(const char* path)
+{
+    Stop();
+
+    filepath = (path != NULL) ? path : "";
+    file = (path != NULL) ? fopen(path, "a") : stdout; /* a restart goes on after the lines of the last run */
+    if (file == NULL) return false;
+
+    long size = (file != stdout && fseek(file, 0, SEEK_END) == 0) ? ftell(file) : 0;
+    written = (size > 0) ? size : 0; /* rotation counts what the last run left in the file */
+    reported = 0;
+    serial = ++serials;
+    running = true;
+    worker = std::thread(&DebugLog::Run, this);
+
+    return true;
+}
+
+void DebugLog::Stop()
+{
+    if (!running) return;
+
+    running = false;
+    worker.join();
+
+    std::string text;
+    Drain(text); /* whatever was logged after the last flush */
+    Output(text);
+
+    if (file != NULL && file != stdout) fclose(file);
+    else if (file != NULL) fflush(file);
+    file = NULL;
+
+    std::lock_guard<std::mutex> guard(lock);
+    for (unsigned int i = 0; i < rings.size(); i++) delete rings[i];
+    rings.clear();
+}
+
+Ring* DebugLog::ThreadRing()
+{
+    if (ringSerial == serial) return ringCached;
+
+    // first record of this thread since Start(): register a ring
+    Ring* ring = new Ring;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        rings.push_back(ring);
+    }
+
+    ringSerial = serial;
+    ringCached = ring;
+
+    return ring;
+}
+
+void DebugLog::Log(Type type, uint32_t frame, int64_t t, const int32_t* v, unsigned int count)
+{
+    if (!running) return;
+
+    Ring* ring = ThreadRing();
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+
+    if (head - ring->tail.load(std::memory_order_acquire) >= DEBUGLOG_RING) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Record& r = ring->slot[head & (DEBUGLOG_RING - 1)];
+
+    if (count > 11) count = 11;
+
+    r.t = t;
+    r.frame = frame;
+    r.type = type;
+    r.count = count;
+    memcpy(r.v, v, count * sizeof(int32_t));
+
+    ring->head.store(head + 1, std::memory_order_release); /* publish */
+}
+
+void DebugLog::LogRows(Type type, uint32_t frame, int64_t t, const int32_t* rows, unsigned int n, unsigned int count)
+{
+    if (!running || n == 0) return;
+
+    if (count > 11) count = 11;
+
+    Ring* ring = ThreadRing();
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    size_t bytes = (size_t) n * count * sizeof(int32_t);
+    uint32_t slots = 1 + (bytes + sizeof(Record) - 1) / sizeof(Record); /* header and payload */
+
+    if (head - ring->tail.load(std::memory_order_acquire) + slots > DEBUGLOG_RING) {
+        ring->dropped.fetch_add(n, std::memory_order_relaxed);
+        return;
+    }
+
+    Record& r = ring->slot[head & (DEBUGLOG_RING - 1)];
+
+    r.t = t;
+    r.frame = frame;
+    r.type = type | ROWS;
+    r.count = count;
+    r.v[0] = n;
+    r.v[1] = slots;
+    CopyIn(ring, head + 1, rows, bytes);
+
+    ring->head.store(head + slots, std::memory_order_release); /* publish */
+}
+
+unsigned long DebugLog::dropped() const
+{
+    unsigned long n = 0;
+
+    std::lock_guard<std::mutex> guard(lock);
+    for (unsigned int i = 0; i < rings.size(); i++) n += rings[i]->dropped.load(std::memory_order_relaxed);
+
+    return n;
+}
+
+void DebugLog::Run()
+{
+    std::string text;
+
+    while (running) {
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(DEBUGLOG_FLUSH_MS));
+
+        text.clear();
+        Drain(text);
+        Output(text);
+    }
+}
+
+unsigned int DebugLog::Drain(std::string& out)
+{
+    std::vector<Ring*> current;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        current = rings;
+    }
+
+    unsigned int n = 0;
+    unsigned long lost = 0;
+
+    for (unsigned int i = 0; i < current.size(); i++) {
+
+        Ring* ring = current[i];
+        uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint32_t head = ring->head.load(std::memory_order_acquire);
+
+        while (tail != head) {
+            const Record& r = ring->slot[tail & (DEBUGLOG_RING - 1)];
+
+            if (r.type & ROWS) {
+                FormatRows(ring, tail, out);
+                n += r.v[0];
+                tail += r.v[1];
+            }
+            else {
+                Format(r, out);
+                n++;
+                tail++;
+            }
+        }
+
+        ring->tail.store(tail, std::memory_order_release); /* slots can be reused */
+
+        lost += ring->dropped.load(std::memory_order_relaxed);
+    }
+
+    if (lost > reported) {
+        out += "[log] " + std::to_string(lost - reported) + " records dropped (ring full), " + std::to_string(lost) + " in total\n";
+        reported = lost;
+    }
+
+    return n;
+}
+
+void DebugLog::Format(const Record& r, std::string& out)
+{
+    static thread_local time_t second = -1;
+    static thread_local char stamp[16];
+
+    // "[HH:MM:SS]" only changes once a second
+    time_t sec = r.t / 1000;
+    if (sec != second) {
+        tm now;
+        localtime_r(&sec, &now);
+        strftime(stamp, sizeof(stamp), "[%H:%M:%S]", &now);
+        second = sec;
+    }
+
+    char line[256];
+    const int32_t* v = r.v;
+
+    switch (r.type) {
+        case TRACK_AMOUNT:
+            snprintf(line, sizeof(line), "%s Amount: %d\n", stamp, v[0]);
+            out += line;
+            if (v[1] > 0) {
+                snprintf(line, sizeof(line), "%s Refused (store full): %d\n", stamp, v[1]);
+                out += line;
+            }
+            break;
+        case TRACK_STATE:
+            snprintf(line, sizeof(line), "%s Ind:%d x:%d y:%d rm:%d life:%d\n%s Colour range of [%d] : H[%d-%d] S[%d-%d] V[%d-%d]\n",
+                     stamp, v[0], v[1], v[2], v[3], v[4], stamp, v[0], v[5], v[6], v[7], v[8], v[9], v[10]);
+            out += line;
+            break;
+        case SEND_HEADER:
+            snprintf(line, sizeof(line), "%s Sent frame %u: %d objects above, send length: %d\n", stamp, r.frame, v[0], v[1]);
+            out += line;
+            break;
+        case SEND_OBJECT:
+            snprintf(line, sizeof(line), "<i>%d<x>%d<y>%d<S>%d\n", v[0], v[1], v[2], v[3]);
+            out += line;
+            break;
+        case TRACKLOG_LOSS:
+            snprintf(line, sizeof(line), "%s Track log: %d frames dropped (disk too slow), %d frames truncated (too many tracks)\n", stamp, v[0], v[1]);
+            out += line;
+            break;
+        case CONTROL_SET: {
+            char param[17];
+            memcpy(param, v, 16);
+            param[16] = '\0';
+            if (v[6] == 2) snprintf(line, sizeof(line), "%s Control: set %s %d %d\n", stamp, param, v[4], v[5]);
+            else snprintf(line, sizeof(line), "%s Control: set %s %d\n", stamp, param, v[4]);
+            out += line;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void DebugLog::FormatRows(const Ring* ring, uint32_t at, std::string& out)
+{
+    Record r = ring->slot[at & (DEBUGLOG_RING - 1)];
+    unsigned int n = r.v[0];
+
+    unpacked.resize((size_t) n * r.count);
+    CopyOut(ring, at + 1, unpacked.data(), unpacked.size() * sizeof(int32_t));
+
+    r.type &= ~ROWS;
+
+    for (unsigned int i = 0; i < n; i++) {
+        memcpy(r.v, &unpacked[(size_t) i * r.count], r.count * sizeof(int32_t));
+        Format(r, out);
+    }
+}
+
+void DebugLog::Output(const std::string& text)
+{
+    if (text.empty() || file == NULL) return;
+
+    if (!filepath.empty() && written + text.size() > DEBUGLOG_ROTATE_BYTES) Rotate();
+
+    fwrite(text.data(), 1, text.size(), file);
+    fflush(file);
+
+    written += text.size();
+}
+
+void DebugLog::Rotate()
+{
+    // the new file is opened first, if that fails logging goes on in the old one
+    std::string next = filepath + ".new";
+    FILE* f = fopen(next.c_str(), "w");
+
+    written = 0; /* either way, next attempt after another DEBUGLOG_ROTATE_BYTES */
+
+    if (f == NULL) {
+        std::string msg = "[log] could not rotate, " + next + ": " + strerror(errno) + "\n";
+        fwrite(msg.data(), 1, msg.size(), file);
+        return;
+    }
+
+    fclose(file);
+
+    // file.N-1 -> file.N, .., file -> file.1, file.new -> file
+    for (int i = DEBUGLOG_ROTATE_FILES - 1; i >= 0; i--) {
+        std::string from = (i == 0) ? filepath : filepath + "." + std::to_string(i);
+        std::string to = filepath + "." + std::to_string(i + 1);
+        rename(from.c_str(), to.c_str());
+    }
+    rename(next.c_str(), filepath.c_str()); /* f stays valid across the rename */
+
+    file = f;
+}
@@ -0,0 +1,115 @@
+/*
+ * File name: DebugLog.hpp
+ * File description: Non-blocking debug/event log, formatted and written by a background thread.
+ *
+ */
+
+#ifndef _DebugLog_HPP_
+#define _DebugLog_HPP_
+
+#define DEBUGLOG_RING 4096              // records per thread, power of two
+#define DEBUGLOG_FLUSH_MS 20            // formatter wakes up this often
+#define DEBUGLOG_ROTATE_BYTES (8 << 20) // log file is rotated at this size
+#define DEBUGLOG_ROTATE_FILES 4         // file.1 .. file.N are kept
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+
+namespace debuglog
+{
+    // what a record stands for, decides how the formatter prints its values
+    enum Type
+    {
+        TRACK_AMOUNT = 1,   // size, refused
+        TRACK_STATE,        // id, x, y, removcnt, lifecnt, lhue, hhue, lsat, hsat, lval, hval
+        SEND_HEADER,        // objects, length
+        SEND_OBJECT,        // id, x, y, area
+        TRACKLOG_LOSS,      // dropped, truncated (totals since -tracklog was opened)
+        CONTROL_SET         // parameter name (16 chars packed into 4 values), value, value, values given
+    };
+
+    // type flag of a LogRows() header: v[0] rows of 'count' values each follow in the next v[1] - 1 slots
+    enum { ROWS = 0x100 };
+
+    struct Record
+    {
+        int64_t t;          // ms since epoch, the caller's frame time
+        uint32_t frame;
+        uint16_t type;
+        uint16_t count;     // values used
+        int32_t v[11];
+    };
+
+    // single producer, single consumer; the producer never waits
+    struct Ring
+    {
+        Record slot[DEBUGLOG_RING];
+        std::atomic<uint32_t> head;     // written by the producer
+        std::atomic<uint32_t> tail;     // written by the formatter
+        std::atomic<uint32_t> dropped;  // records lost because the ring was full
+
+        Ring() : head(0), tail(0), dropped(0) {}
+    };
+}
+
+/*
+ * Log() copies a fixed-size record into a ring owned by the calling thread,
+ * so the frame loop pays neither locks, clock calls nor formatting. Every
+ * thread gets its own ring the first time it logs. LogRows() puts the
+ * per-object lines of a frame into one header slot followed by the packed
+ * values, so logging every object costs one copy. The formatter thread
+ * drains the rings, turns records into the same "[HH:MM:SS] ..." lines the
+ * tracker printed before, and reports lost records as they happen. Nothing
+ * runs until Start(), the tracker calls it with its first record.
+ */
+class DebugLog
+{
+    public:
+
+    DebugLog() : file(NULL), running(false), serial(0), written(0), reported(0) {}
+    ~DebugLog() { Stop(); }
+
+    // write to stdout (path NULL) or append to a file rotated at DEBUGLOG_ROTATE_BYTES
+    bool Start(const char* path);
+    void Stop(); /* flushes everything queued, must not run while another thread logs */
+
+    bool isRunning() const { return running; }
+
+    // queue one record, dropped (and counted) when the ring of this thread is full
+    void Log(debuglog::Type type, uint32_t frame, int64_t t, const int32_t* v, unsigned int count);
+
+    // queue n rows of count values as one record (one copy per frame instead of one Log() per object),
+    // every row is printed like a record of that type; all rows are dropped when they don't fit
+    void LogRows(debuglog::Type type, uint32_t frame, int64_t t, const int32_t* rows, unsigned int n, unsigned int count);
+
+    unsigned long dropped() const; /* records lost so far, all threads */
+
+    private:
+
+    FILE* file;
+    std::string filepath;       // empty: stdout
+    std::thread worker;
+    std::atomic<bool> running;
+    unsigned int serial;        // tells rings of this Start() apart from earlier ones
+    size_t written;             // bytes in the current file
+    unsigned long reported;     // drops already reported in the log
+    std::vector<int32_t> unpacked; // formatter only, rows of a LogRows() record
+
+    mutable std::mutex lock;    // guards rings, only taken when a thread logs for the first time
+    std::vector<debuglog::Ring*> rings;
+
+    debuglog::Ring* ThreadRing();
+    void Run();
+    unsigned int Drain(std::string& out);
+    void Format(const debuglog::Record& r, std::string& out);
+    void FormatRows(const debuglog::Ring* ring, uint32_t at, std::string& out);
+    void Output(const std::string& text);
+    void Rotate();
+};
+
+#endif
@@ -0,0 +1,206 @@
+/*
+ * File name: PixelKernels.cpp
+ * File description: Implementation of the specialised kernels and their dispatch tables.
+ *
+ */
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "PixelKernels.hpp"
+
+#include <cstring>
+#include <vector>
+
+/*
+ * Options are template parameters, so every instance only contains the
+ * calls its configuration needs. The threshold converts, blurs and compares
+ * one band of TILE_SIZE rows at a time, so the HSV rows are still in cache
+ * when they are compared. Without saturation and value limits only the hue
+ * plane is blurred and compared, a third of the work of the 3 channel path.
+ */
+template<bool BLUR, bool WRAP, bool HUEONLY>
+static void ThresholdBands(const cv::Mat& src, cv::Mat& dst, const int hsv[], TileMap* tiles)
+{
+    static thread_local cv::Mat conv, plane, blurred, higher, lower; /* reused, only reallocated when the size changes */
+
+    dst.create(src.size(), CV_8U);
+    conv.create(src.size(), CV_8UC3);
+    if (HUEONLY) plane.create(src.size(), CV_8U);
+    if (BLUR) blurred.create(src.size(), HUEONLY ? CV_8U : CV_8UC3);
+
+    int converted = 0;
+
+    for (int y0 = 0; y0 < src.rows; y0 += TILE_SIZE) {
+
+        int y1 = std::min(y0 + TILE_SIZE, src.rows);
+        int need = BLUR ? std::min(y1 + BLUR_REACH, src.rows) : y1; /* blur reads rows of the next band */
+
+        cv::Mat rows = conv.rowRange(converted, need);
+        cv::cvtColor(src.rowRange(converted, need), rows, cv::COLOR_BGR2HSV);
+
+        if (HUEONLY) {
+            cv::Mat hue = plane.rowRange(converted, need);
+            cv::extractChannel(rows, hue, 0);
+        }
+        converted = need;
+
+        cv::Mat in = HUEONLY ? plane.rowRange(y0, y1) : conv.rowRange(y0, y1);
+        if (BLUR) { /* the full size plane is the parent of the ROI, rows around it are read as in a whole frame blur */
+            cv::Mat smooth = blurred.rowRange(y0, y1);
+            cv::GaussianBlur(in, smooth, cv::Size(5,5), 0,0);
+            in = smooth;
+        }
+
+        cv::Mat out = dst.rowRange(y0, y1);
+        if (HUEONLY && !WRAP) {
+            cv::inRange(in, cv::Scalar(hsv[0]), cv::Scalar(hsv[1]), out);
+        }
+        else if (HUEONLY) { /* outside the gap between hhue and lhue, one compare instead of two */
+            cv::inRange(in, cv::Scalar(hsv[1] + 1), cv::Scalar(hsv[0] - 1), out);
+            cv::bitwise_not(out, out);
+        }
+        else if (!WRAP) {
+            cv::inRange(in, cv::Scalar(hsv[0], hsv[2], hsv[4]), cv::Scalar(hsv[1], hsv[3], hsv[5]), out);
+        }
+        else { /* hue range wraps around */
+            cv::inRange(in, cv::Scalar(hsv[0], hsv[2], hsv[4]), cv::Scalar(179, hsv[3], hsv[5]), higher); /* hue is 0..179 */
+            cv::inRange(in, cv::Scalar(0, hsv[2], hsv[4]), cv::Scalar(hsv[1], hsv[3], hsv[5]), lower);
+            cv::add(higher, lower, out);
+        }
+
+        if (tiles != NULL) {
+            for (int y = y0; y < y1; y++) tiles->MarkRow(y, dst.ptr<uchar>(y));
+        }
+    }
+}
+
+/*
+ * The 3x3 ellipse is a cross, and on a 0/255 mask erode and dilate with it
+ * are the AND and the OR of a pixel and its four neighbours. All erode and
+ * dilate steps of a level run in one pass down the mask: each step keeps a
+ * ring of its last 3 input rows and hands every finished row to the next
+ * step, so the mask is read and written once instead of once per step.
+ * Rows are padded with the identity of their step (255 for erode, 0 for
+ * dilate), which is the border cv::erode and cv::dilate use.
+ */
+#define MORPH_PAD 16    // padding bytes on both sides of a ring row, vector loads reach one byte past each side
+
+typedef uchar Bytes16 __attribute__((vector_size(16)));
+
+static inline Bytes16 Load(const uchar* p) { Bytes16 v; memcpy(&v, p, sizeof(v)); return v; }
+static inline void Store(uchar* p, Bytes16 v) { memcpy(p, &v, sizeof(v)); }
+
+template<bool ERODE>
+static inline void Cross(const uchar* up, const uchar* row, const uchar* down, uchar* out, int width)
+{
+    for (int x = 0; x < width; x += 16) {
+        Bytes16 v = ERODE ? (Load(row + x) & Load(row + x - 1) & Load(row + x + 1) & Load(up + x) & Load(down + x))
+                          : (Load(row + x) | Load(row + x - 1) | Load(row + x + 1) | Load(up + x) | Load(down + x));
+        Store(out + x, v);
+    }
+}
+
+// same steps as ColourTracking::MorphImage: level 1 erodes twice, level 2 erodes, dilates twice and erodes
+static inline bool Erodes(int level, int step)
+{
+    return level == 1 || step == 0 || step == 3;
+}
+
+// level 0 doesn't morph
+static void MorphCopy(const cv::Mat& src, cv::Mat& dst)
+{
+    if (dst.data != src.data) src.copyTo(dst);
+}
+
+template<int LEVEL>
+static void Morph(const cv::Mat& src, cv::Mat& dst)
+{
+    const int steps = 2 * LEVEL;
+
+    static thread_local std::vector<uchar> buf;
+
+    int w = src.cols, h = src.rows;
+    int width = (w + 15) & ~15; /* whole vectors */
+    int stride = width + 2 * MORPH_PAD;
+
+    // per step: 3 ring rows and an identity row for the frame edges, then one output row
+    buf.resize((size_t) stride * (4 * steps + 1));
+
+    uchar* ring[steps][3];
+    uchar* edge[steps];
+    uchar* out = &buf[(size_t) stride * 4 * steps] + MORPH_PAD;
+
+    for (int s = 0; s < steps; s++) {
+        uchar* base = &buf[(size_t) stride * 4 * s];
+        memset(base, Erodes(LEVEL, s) ? 255 : 0, (size_t) stride * 4);
+        for (int j = 0; j < 3; j++) ring[s][j] = base + (size_t) stride * j + MORPH_PAD;
+        edge[s] = base + (size_t) stride * 3 + MORPH_PAD;
+    }
+
+    dst.create(src.size(), CV_8U);
+
+    // step s finishes row t - s - 1 once row t came in, so dst row y is written after src row y + steps was read (in place works)
+    for (int t = 0; t < h + steps; t++) {
+
+        if (t < h) {
+            uchar* r = ring[0][t % 3];
+            memcpy(r, src.ptr<uchar>(t), w);
+            memset(r + w, Erodes(LEVEL, 0) ? 255 : 0, width - w);
+        }
+
+        for (int s = 0; s < steps; s++) {
+
+            int y = t - s - 1;
+            if (y < 0 || y >= h) continue;
+
+            const uchar* up = (y > 0) ? ring[s][(y - 1) % 3] : edge[s];
+            const uchar* down = (y + 1 < h) ? ring[s][(y + 1) % 3] : edge[s];
+            uchar* o = (s + 1 < steps) ? ring[s + 1][y % 3] : out;
+
+            if (Erodes(LEVEL, s)) Cross<true>(up, ring[s][y % 3], down, o, width);
+            else Cross<false>(up, ring[s][y % 3], down, o, width);
+
+            if (s + 1 < steps) memset(o + w, Erodes(LEVEL, s + 1) ? 255 : 0, width - w); /* tail is read by the next step */
+            else memcpy(dst.ptr<uchar>(y), out, w);
+        }
+    }
+}
+
+// indexed by the KERNEL_* bits
+static const ThresholdKernel thresholdTable[KERNEL_VARIANTS] = {
+    ThresholdBands<false, false, false>,
+    ThresholdBands<false, false, true>,
+    ThresholdBands<false, true, false>,
+    ThresholdBands<false, true, true>,
+    ThresholdBands<true, false, false>,
+    ThresholdBands<true, false, true>,
+    ThresholdBands<true, true, false>,
+    ThresholdBands<true, true, true>
+};
+
+static const MorphKernel morphTable[MORPH_LEVELS] = {
+    MorphCopy,
+    Morph<1>,
+    Morph<2>
+};
+
+int ThresholdVariant(const int hsv[], bool blur)
+{
+    int variant = 0;
+
+    if (hsv[2] == 0 && hsv[3] == 255 && hsv[4] == 0 && hsv[5] == 255) variant |= KERNEL_HUEONLY;
+    if (hsv[0] > hsv[1]) variant |= KERNEL_WRAP;
+    if (blur) variant |= KERNEL_BLUR;
+
+    return variant;
+}
+
+ThresholdKernel SelectThreshold(int variant)
+{
+    return thresholdTable[variant & (KERNEL_VARIANTS - 1)];
+}
+
+MorphKernel SelectMorph(int level)
+{
+    return (level >= 0 && level < MORPH_LEVELS) ? morphTable[level] : NULL;
+}
@@ -0,0 +1,37 @@
+/*
+ * File name: PixelKernels.hpp
+ * File description: Threshold and morph kernels specialised at compile time for each configuration.
+ *
+ */
+
+#ifndef _PixelKernels_HPP_
+#define _PixelKernels_HPP_
+
+#include "opencv2/core/core.hpp"
+#include "TileMap.hpp"
+
+// bits of a threshold variant, all 8 combinations are instantiated in PixelKernels.cpp
+#define KERNEL_HUEONLY 1    // saturation and value ranges are 0..255, only the hue plane is blurred and compared
+#define KERNEL_WRAP 2       // hue range wraps around (lhue > hhue)
+#define KERNEL_BLUR 4       // 5x5 Gaussian on the HSV image before comparing
+#define KERNEL_VARIANTS 8
+
+#define MORPH_LEVELS 3      // morph kernels for levels 0..2
+#define BLUR_REACH 2        // rows the 5x5 Gaussian of the threshold reads above and below a row
+
+// BGR frame -> binary mask (0/255), same result as ColourTracking::ThresholdImage. Runs one tile row at
+// a time and marks the occupied tiles of each band (when tiles isn't NULL) while it is still in cache
+typedef void (*ThresholdKernel)(const cv::Mat& src, cv::Mat& dst, const int hsv[], TileMap* tiles);
+
+// binary mask (0/255) -> morphed mask, same result as ColourTracking::MorphImage with the 3x3 ellipse;
+// src and dst may be the same Mat (or the same ROI)
+typedef void (*MorphKernel)(const cv::Mat& src, cv::Mat& dst);
+
+// which variant handles {lhue, hhue, lsat, hsat, lval, hval}
+int ThresholdVariant(const int hsv[], bool blur);
+
+ThresholdKernel SelectThreshold(int variant);
+
+MorphKernel SelectMorph(int level);
+
+#endif
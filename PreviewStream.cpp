@@ -0,0 +1,234 @@
+/*
+ * File name: PreviewStream.cpp
+ * File description: Implementation of PreviewStream class.
+ *
+ */
+
+#include "opencv2/imgproc/imgproc.hpp"
+#include "opencv2/imgcodecs/imgcodecs.hpp"
+
+#include "PreviewStream.hpp"
+
+#include <chrono>
+#include <string>
+#include <cstring>
+
+/** Includes for socket communication **/
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+bool PreviewStream::Start(unsigned int port)
+{
+    Stop();
+
+    listenfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenfd < 0) return false;
+
+    int on = 1;
+    setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); /* local only, reach it remotely via ssh -L */
+    addr.sin_port = htons(port);
+
+    if (bind(listenfd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(listenfd, 4) < 0) {
+        close(listenfd);
+        listenfd = -1;
+        return false;
+    }
+
+    lastRequest = now() - PREVIEW_IDLE_MS - 1; /* nobody has asked yet */
+    lastSubmit = 0;
+    frameReady = false;
+    jpeg.clear();
+    jpegTime = 0;
+
+    running = true;
+    worker = std::thread(&PreviewStream::Run, this);
+
+    return true;
+}
+
+void PreviewStream::Stop()
+{
+    if (!running) return;
+
+    running = false;
+    worker.join();
+
+    close(listenfd);
+    listenfd = -1;
+}
+
+bool PreviewStream::Wanted()
+{
+    if (!running) return false;
+
+    int64_t t = now();
+
+    if (t - lastRequest > PREVIEW_IDLE_MS) return false; /* no consumer, no cost */
+
+    return (t - lastSubmit) >= 1000 / fps;
+}
+
+void PreviewStream::Submit(const cv::Mat& src, const std::vector<Circle>& c, int code)
+{
+    lastSubmit = now();
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    src.copyTo(frame);
+    conversion = code;
+    circles = c;
+    frameReady = true;
+}
+
+void PreviewStream::DrawCircles(cv::Mat& dst, const std::vector<Circle>& c, double scale)
+{
+    for (unsigned int i = 0; i < c.size(); i++) {
+
+        cv::Point p(c[i].x * scale, c[i].y * scale);
+
+        cv::circle(dst, p, c[i].r * scale, cv::Scalar(0,0,255), 2, 8, 0);
+
+        if (c[i].center) cv::circle(dst, p, 3, cv::Scalar(0,255,0), 2, 8, 0); // draw mass center
+    }
+}
+
+void PreviewStream::Run()
+{
+    std::vector<int> clients;       // connections waiting for an image
+    std::vector<int64_t> asked;     // and when they asked
+
+    while (running) {
+
+        struct pollfd p = { listenfd, POLLIN, 0 };
+
+        if (poll(&p, 1, 50) > 0) {
+            int fd = accept(listenfd, NULL, NULL);
+            if (fd >= 0 && ReadRequest(fd)) {
+                lastRequest = now(); /* tracking loop starts handing over frames */
+                clients.push_back(fd);
+                asked.push_back(now());
+            }
+        }
+
+        Encode();
+
+        int64_t t = now();
+
+        for (unsigned int i = 0; i < clients.size(); ) {
+
+            // answer with an image taken after the request, or give up waiting
+            if ((!jpeg.empty() && jpegTime >= asked[i] - 1000 / fps) || t - asked[i] > PREVIEW_WAIT_MS) {
+                Serve(clients[i]);
+                clients.erase(clients.begin() + i);
+                asked.erase(asked.begin() + i);
+            }
+            else i++;
+        }
+    }
+
+    for (unsigned int i = 0; i < clients.size(); i++) close(clients[i]);
+}
+
+void PreviewStream::Encode()
+{
+    cv::Mat src, small;
+    std::vector<Circle> c;
+    int code;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        if (!frameReady) return;
+
+        src = frame;
+        frame = cv::Mat(); /* next Submit() gets a fresh buffer, src stays ours */
+        code = conversion;
+        c.swap(circles);
+        frameReady = false;
+    }
+
+    if (code >= 0) cv::cvtColor(src, src, code); /* YUV input, the tracking loop never converts it for us */
+
+    unsigned int w = width; /* read once, setWidth() may run meanwhile */
+    double scale = (src.cols > (int) w) ? (double) w / src.cols : 1.0;
+
+    cv::resize(src, small, cv::Size(src.cols * scale, src.rows * scale), 0, 0, cv::INTER_AREA);
+    DrawCircles(small, c, scale);
+
+    std::vector<int> params;
+    params.push_back(cv::IMWRITE_JPEG_QUALITY);
+    params.push_back(PREVIEW_QUALITY);
+
+    cv::imencode(".jpg", small, jpeg, params);
+    jpegTime = now();
+}
+
+// read the request up to the end of its headers, so closing the connection can't reset it before the reply arrives
+bool PreviewStream::ReadRequest(int fd)
+{
+    struct timeval tv = { 0, PREVIEW_READ_MS * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    char request[2048];
+    size_t len = 0;
+
+    while (len < sizeof(request) - 1) {
+
+        ssize_t n = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+        if (n <= 0) break; /* timeout, error or closed */
+
+        len += n;
+        request[len] = 0;
+
+        if (strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL) break;
+    }
+
+    request[len] = 0;
+
+    if (strncmp(request, "GET ", 4) != 0 || strchr(request, '\n') == NULL) { /* no complete request line */
+        if (len > 0) {
+            const char* reply = "HTTP/1.0 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+            send(fd, reply, strlen(reply), MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+        close(fd);
+        return false;
+    }
+
+    return true;
+}
+
+void PreviewStream::Serve(int fd)
+{
+    struct timeval tv = { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)); /* slow clients can't hold the thread */
+
+    std::string header;
+
+    if (jpeg.empty()) {
+        header = "HTTP/1.0 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+        send(fd, header.c_str(), header.size(), MSG_NOSIGNAL);
+    }
+    else {
+        header = "HTTP/1.0 200 OK\r\nContent-Type: image/jpeg\r\nCache-Control: no-cache\r\n";
+        header += "Content-Length: " + std::to_string(jpeg.size()) + "\r\n\r\n";
+        send(fd, header.c_str(), header.size(), MSG_NOSIGNAL);
+        send(fd, jpeg.data(), jpeg.size(), MSG_NOSIGNAL);
+    }
+
+    close(fd);
+}
+
+int64_t PreviewStream::now()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>
+           (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,99 @@
+/*
+ * File name: PreviewStream.hpp
+ * File description: Rate-limited JPEG preview served on a local socket.
+ *
+ */
+
+#ifndef _PreviewStream_HPP_
+#define _PreviewStream_HPP_
+
+#define PREVIEW_FPS 2           // default preview rate
+#define PREVIEW_MAX_FPS 10
+#define PREVIEW_WIDTH 320       // default width of preview images
+#define PREVIEW_QUALITY 70      // JPEG quality
+#define PREVIEW_IDLE_MS 5000    // frames are only handed over this long after the last request
+#define PREVIEW_WAIT_MS 2000    // how long a request may wait for the first image
+#define PREVIEW_READ_MS 500     // how long a client may take to send its request
+
+#include "opencv2/core/core.hpp"
+
+#include <stdint.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+/*
+ * Serves the latest annotated frame as a downscaled JPEG over HTTP on
+ * 127.0.0.1:<port>, e.g. "curl -o cam.jpg http://127.0.0.1:<port>/".
+ *
+ * The tracking loop asks Wanted() once per frame. Only when a client has
+ * asked for an image recently and the rate limit allows it does the loop pay
+ * for one frame copy in Submit(); colour conversion of YUV input, scaling,
+ * drawing and encoding happen on the preview thread.
+ */
+class PreviewStream
+{
+    public:
+
+    // overlay for one tracked object
+    struct Circle
+    {
+        int x;
+        int y;
+        int r;
+        bool center; // mark mass center as well
+    };
+
+    PreviewStream() : listenfd(-1), running(false), fps(PREVIEW_FPS), width(PREVIEW_WIDTH),
+                      lastRequest(0), lastSubmit(0), conversion(-1), frameReady(false), jpegTime(0) {}
+    ~PreviewStream() { Stop(); }
+
+    void setRate(unsigned int f) { fps = f; }
+    void setWidth(unsigned int w) { width = w; }
+
+    // bind 127.0.0.1:port and start the preview thread
+    bool Start(unsigned int port);
+    void Stop();
+
+    bool isRunning() const { return running; }
+
+    // true when a client is waiting and a new frame is due
+    bool Wanted();
+
+    // hand over a frame and its overlays to the preview thread; a raw YUV frame is converted there with cvtColor code 'conversion'
+    void Submit(const cv::Mat& frame, const std::vector<Circle>& circles, int conversion = -1);
+
+    // draw overlays in place, coordinates are multiplied by scale
+    static void DrawCircles(cv::Mat& dst, const std::vector<Circle>& circles, double scale);
+
+    private:
+
+    int listenfd;
+    std::thread worker;
+    std::atomic<bool> running;
+
+    std::atomic<unsigned int> fps;    // both can be changed while the thread runs
+    std::atomic<unsigned int> width;
+
+    std::atomic<int64_t> lastRequest; // ms, steady clock
+    int64_t lastSubmit;               // only touched by the tracking loop
+
+    std::mutex lock;                  // guards the submitted frame
+    cv::Mat frame;
+    int conversion;                   // cvtColor code for frame, -1 when it is BGR already
+    std::vector<Circle> circles;
+    bool frameReady;
+
+    std::vector<uchar> jpeg;          // latest encoded image, preview thread only
+    int64_t jpegTime;
+
+    void Run();
+    void Encode();
+    bool ReadRequest(int fd);
+    void Serve(int fd);
+
+    static int64_t now();
+};
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * File name: RawVideo.cpp
+ * File description: Implementation of RawVideo class.
+ *
+ */
+
+#include "ColourTracking.hpp"
+#include "RawVideo.hpp"
+
+bool RawVideo::Open(const char* path, int format, unsigned int width, unsigned int height)
+{
+    Close();
+
+    if ((format != INPUT_YUYV && format != INPUT_NV12) || width % 2 || height % 2) return false;
+
+    file = fopen(path, "rb");
+    if (file == NULL) return false;
+
+    fmt = format;
+    w = width;
+    h = height;
+
+    return true;
+}
+
+void RawVideo::Close()
+{
+    if (file != NULL) fclose(file);
+
+    file = NULL;
+}
+
+bool RawVideo::Read(cv::Mat& frame)
+{
+    if (file == NULL) return false;
+
+    if (fmt == INPUT_YUYV) frame.create(h, w, CV_8UC2);
+    else frame.create(h * 3 / 2, w, CV_8UC1);
+
+    return fread(frame.data, frame.total() * frame.elemSize(), 1, file) == 1;
+}
@@ -0,0 +1,45 @@
+/*
+ * File name: RawVideo.hpp
+ * File description: Reads raw YUYV / NV12 frames from a file, stands in for a camera.
+ *
+ */
+
+#ifndef _RawVideo_HPP_
+#define _RawVideo_HPP_
+
+#include "opencv2/core/core.hpp"
+
+#include <cstdio>
+
+/*
+ * Frames are stored back to back without headers, e.g. as written by
+ * "ffmpeg -i in.mp4 -pix_fmt nv12 -s 320x240 -f rawvideo out.nv12".
+ * Read() returns them in the layout the camera delivers:
+ *   YUYV - height x width, CV_8UC2 (Y0 U Y1 V per pixel pair)
+ *   NV12 - height * 3/2 x width, CV_8UC1 (Y plane, then interleaved UV at half resolution)
+ */
+class RawVideo
+{
+    public:
+
+    RawVideo() : file(NULL) {}
+    ~RawVideo() { Close(); }
+
+    // format is INPUT_YUYV or INPUT_NV12, width and height must be even
+    bool Open(const char* path, int format, unsigned int width, unsigned int height);
+    void Close();
+
+    bool isOpen() const { return file != NULL; }
+
+    // next frame, false at the end of the file
+    bool Read(cv::Mat& frame);
+
+    private:
+
+    FILE* file;
+    int fmt;
+    unsigned int w;
+    unsigned int h;
+};
+
+#endif
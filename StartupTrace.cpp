@@ -0,0 +1,88 @@
+/*
+ * File name: StartupTrace.cpp
+ * File description: Implementation of StartupTrace class.
+ *
+ */
+
+#include "StartupTrace.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include <unistd.h>
+
+using namespace std::chrono;
+
+// ms the process has been running according to the kernel, -1 if unknown
+static double ProcessAge()
+{
+    FILE* f = fopen("/proc/self/stat", "r");
+    if (f == NULL) return -1;
+
+    char buf[1024];
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+
+    // starttime is field 22, counted after the ")" that closes the command name
+    const char* p = strrchr(buf, ')');
+    if (p == NULL) return -1;
+
+    unsigned long long start = 0;
+    int field = 2;
+
+    for (p++; *p && field < 22; p++) {
+        if (*p == ' ') field++;
+    }
+    if (sscanf(p, "%llu", &start) != 1) return -1;
+
+    struct timespec boot;
+    if (clock_gettime(CLOCK_BOOTTIME, &boot) < 0) return -1;
+
+    double ticks = sysconf(_SC_CLK_TCK);
+
+    return boot.tv_sec * 1000.0 + boot.tv_nsec / 1e6 - start * 1000.0 / ticks;
+}
+
+StartupTrace::StartupTrace()
+{
+    double age = ProcessAge();
+
+    exec = steady_clock::now();
+    if (age > 0) exec -= duration_cast<steady_clock::duration>(duration<double, std::milli>(age));
+}
+
+double StartupTrace::now() const
+{
+    return duration<double, std::milli>(steady_clock::now() - exec).count();
+}
+
+bool StartupTrace::Mark(const char* what)
+{
+    double t = now();
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    for (unsigned int i = 0; i < marks.size(); i++) {
+        if (marks[i].first == what) return false;
+    }
+
+    marks.push_back(std::make_pair(std::string(what), t));
+
+    return true;
+}
+
+std::string StartupTrace::Report() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    std::string out;
+
+    for (unsigned int i = 0; i < marks.size(); i++) {
+        char buf[96];
+        snprintf(buf, sizeof(buf), "%s%s %.0fms", i ? ", " : "", marks[i].first.c_str(), marks[i].second);
+        out += buf;
+    }
+
+    return out;
+}
@@ -0,0 +1,42 @@
+/*
+ * File name: StartupTrace.hpp
+ * File description: Startup milestones, measured from the moment the process was executed.
+ *
+ */
+
+#ifndef _StartupTrace_HPP_
+#define _StartupTrace_HPP_
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+
+/*
+ * The zero point is the process start time from /proc/self/stat, so time
+ * spent loading shared libraries (OpenCV) before main() is included.
+ * Marks can come from any thread; each name is only recorded once.
+ */
+class StartupTrace
+{
+    public:
+
+    StartupTrace();
+
+    // record a milestone, returns false if it was already recorded
+    bool Mark(const char* what);
+
+    // ms since exec
+    double now() const;
+
+    // "socket 3ms, camera 412ms, .."
+    std::string Report() const;
+
+    private:
+
+    std::chrono::steady_clock::time_point exec; // steady clock equivalent of the process start
+    mutable std::mutex lock;
+    std::vector<std::pair<std::string, double> > marks;
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * File name: StateFile.cpp
+ * File description: Implementation of StateFile class.
+ *
+ */
+
+#include "StateFile.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace trackstate;
+
+bool StateFile::Open(const char* path)
+{
+    Close();
+
+    static_assert(sizeof(Header) == STATEFILE_HEADER, "state file header must be 128 bytes");
+
+    size_t size = STATEFILE_HEADER + MAX_TRACKS_LIMIT * sizeof(Track) + YUV_TABLE_BYTES;
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return false;
+    }
+
+    bool resized = ((size_t) st.st_size != size); /* records and table would sit at other offsets than they were saved at */
+
+    if (resized && ftruncate(fd, size) < 0) {
+        close(fd);
+        return false;
+    }
+
+    void* m = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); /* mapping stays valid */
+
+    if (m == MAP_FAILED) return false;
+
+    map = (char*) m;
+    length = size;
+
+    Header* h = header();
+
+    // new file, another layout or another size (other MAX_TRACKS_LIMIT or YUV_TABLE_BYTES): start empty
+    if (resized || strncmp(h->magic, STATEFILE_MAGIC, sizeof(h->magic)) || h->version != STATEFILE_VERSION) {
+        memset(h, 0, sizeof(Header));
+        strncpy(h->magic, STATEFILE_MAGIC, sizeof(h->magic));
+        h->version = STATEFILE_VERSION;
+    }
+
+    return true;
+}
+
+void StateFile::Close()
+{
+    if (map != NULL) munmap(map, length);
+
+    map = NULL;
+    length = 0;
+}
+
+bool StateFile::Restore(int64_t now, int width, int height, TrackStore& obj, unsigned int& idcounter)
+{
+    if (map == NULL) return false;
+
+    const Header* h = header();
+
+    if (h->seq & 1) return false; /* killed while writing */
+    if (h->width != width || h->height != height) return false;
+    if (h->t <= 0 || now - h->t > STATEFILE_MAX_AGE || h->count > MAX_TRACKS_LIMIT) return false;
+
+    obj.Clear();
+
+    for (unsigned int k = 0; k < h->count && !obj.full(); k++) {
+
+        const Track& r = tracks()[k];
+        TrackStore::Handle hd = obj.Insert(r.id, r.x, r.y, r.area, r.removcnt, r.hsv);
+
+        int i = obj.Find(hd);
+        if (i >= 0) obj.lifecnt[i] = r.lifecnt; /* confirmed tracks are reported right away */
+    }
+
+    idcounter = h->idcounter;
+
+    return true;
+}
+
+void StateFile::Save(int64_t t, uint32_t frame, int width, int height, const TrackStore& obj, const std::vector<unsigned int>& order, unsigned int idcounter)
+{
+    if (map == NULL) return;
+
+    Header* h = header();
+    unsigned int n = std::min((unsigned int) order.size(), (unsigned int) MAX_TRACKS_LIMIT);
+
+    h->seq |= 1; /* odd: snapshot incomplete (already odd if the last writer was killed) */
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+
+    for (unsigned int k = 0; k < n; k++) {
+
+        unsigned int i = order[k];
+        Track& r = tracks()[k];
+        const int* hsv = obj.hsv(i);
+
+        r.id = obj.id(i);
+        r.x = obj.x[i];
+        r.y = obj.y[i];
+        r.area = obj.area[i];
+        r.removcnt = obj.removcnt[i];
+        r.lifecnt = obj.lifecnt[i];
+        for (unsigned int k = 0; k < 6; k++) r.hsv[k] = hsv[k];
+    }
+
+    h->t = t;
+    h->frame = frame;
+    h->idcounter = idcounter;
+    h->count = n;
+    h->width = width;
+    h->height = height;
+
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    h->seq = (h->seq | 1) + 1; /* even: complete */
+}
+
+const unsigned char* StateFile::Table(const int hsv[6]) const
+{
+    if (map == NULL || header()->table != 1) return NULL;
+
+    for (unsigned int k = 0; k < 6; k++) {
+        if (header()->tablehsv[k] != hsv[k]) return NULL;
+    }
+
+    return table();
+}
+
+void StateFile::SaveTable(const int hsv[6], const std::vector<unsigned char>& yuvtable)
+{
+    if (map == NULL || yuvtable.size() != YUV_TABLE_BYTES || Table(hsv) != NULL) return;
+
+    Header* h = header();
+
+    h->table = 0;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+
+    memcpy(table(), &yuvtable[0], YUV_TABLE_BYTES);
+    for (unsigned int k = 0; k < 6; k++) h->tablehsv[k] = hsv[k];
+
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    h->table = 1;
+}
@@ -0,0 +1,95 @@
+/*
+ * File name: StateFile.hpp
+ * File description: Memory-mapped snapshot of tracker state, lets a restarted tracker resume its tracks.
+ *
+ */
+
+#ifndef _StateFile_HPP_
+#define _StateFile_HPP_
+
+#define STATEFILE_MAGIC "PCTSTAT"
+#define STATEFILE_VERSION 1
+#define STATEFILE_HEADER 128        // header size, track records follow it
+#define STATEFILE_MAX_AGE 30000     // ms, older snapshots are not resumed
+
+#include "TrackStore.hpp"
+#include "TrackerConfig.hpp"
+
+#include <stdint.h>
+#include <vector>
+
+/*
+ * File layout (native byte order, fixed size):
+ *
+ *   [header, 128 bytes][MAX_TRACKS_LIMIT track records][YUV table, YUV_TABLE_BYTES]
+ *
+ * Save() copies the live tracks into the mapping every frame; the kernel
+ * writes the pages back, so the snapshot survives the process being killed.
+ * The header sequence number is odd while a frame is being written, a
+ * snapshot torn by a crash is recognised and ignored. The YUV table of the
+ * last colour range is kept too, so it doesn't have to be rebuilt on restart.
+ */
+namespace trackstate
+{
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t seq;       // odd while tracks are being written
+        int64_t t;          // frame time of the snapshot, ms since epoch
+        uint32_t frame;
+        uint32_t idcounter; // last ID handed out
+        uint32_t count;     // valid track records
+        int32_t width;      // capture size the positions refer to
+        int32_t height;
+        uint32_t table;     // 1 when the YUV table below is complete
+        int32_t tablehsv[6]; // colour range the table was built for
+        char reserved[STATEFILE_HEADER - 72];
+    };
+
+    struct Track
+    {
+        uint32_t id;
+        int32_t x;
+        int32_t y;
+        int32_t area;
+        uint32_t removcnt;
+        uint32_t lifecnt;
+        int32_t hsv[6];
+    };
+}
+
+class StateFile
+{
+    public:
+
+    StateFile() : map(NULL), length(0) {}
+    ~StateFile() { Close(); }
+
+    // map (and create or resize) the state file, a file of another size is started empty
+    bool Open(const char* path);
+    void Close();
+
+    bool isOpen() const { return map != NULL; }
+
+    // put saved tracks back into obj; false when there is no recent, complete snapshot of this capture size
+    bool Restore(int64_t now, int width, int height, TrackStore& obj, unsigned int& idcounter);
+
+    // snapshot of the tracks after a frame, stored in the given order (dense positions) so Restore() inserts them in it
+    void Save(int64_t t, uint32_t frame, int width, int height, const TrackStore& obj, const std::vector<unsigned int>& order, unsigned int idcounter);
+
+    // YUV table saved for this colour range, NULL if there is none
+    const unsigned char* Table(const int hsv[6]) const;
+    void SaveTable(const int hsv[6], const std::vector<unsigned char>& table);
+
+    private:
+
+    char* map;
+    size_t length;
+
+    trackstate::Header* header() const { return (trackstate::Header*) map; }
+    trackstate::Track* tracks() const { return (trackstate::Track*) (map + STATEFILE_HEADER); }
+    unsigned char* table() const { return (unsigned char*) (map + STATEFILE_HEADER + MAX_TRACKS_LIMIT * sizeof(trackstate::Track)); }
+};
+
+#endif
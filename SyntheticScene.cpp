@@ -0,0 +1,133 @@
+/*
+ * File name: SyntheticScene.cpp
+ * File description: Implementation of SyntheticScene class.
+ *
+ */
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "SyntheticScene.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#define SCENE_PI 3.1415926535
+#define SCENE_SAT 220           // saturation of objects
+#define SCENE_VAL 190           // brightness of objects before drift
+#define SCENE_DRIFT_PERIOD 150  // frames per brightness drift cycle
+
+SyntheticScene::SyntheticScene(const Options& options) : opt(options), rng(options.seed)
+{
+    cv::RNG r(opt.seed);
+
+    unsigned int total = opt.targets + opt.distractors;
+    float frame = (float) opt.width * opt.height;
+
+    for (unsigned int k = 0; k < total; k++) {
+
+        Body b;
+
+        b.target = (k < opt.targets);
+        b.ellipse = (r.uniform(0, 2) == 1);
+
+        // objects stay above the default minimum size (1% of the frame)
+        float frac = r.uniform(0.015f, std::max(0.025f, 0.12f / total));
+        float rad = sqrt(frac * frame / SCENE_PI);
+
+        b.ax = b.ellipse ? rad * 1.4f : rad;
+        b.ay = b.ellipse ? rad / 1.4f : rad;
+        b.angle = r.uniform(0.0f, 180.0f);
+
+        if (b.target) {
+            if (opt.red) b.hue = (r.uniform(0, 2) == 1) ? r.uniform(174, 180) : r.uniform(0, 7);
+            else b.hue = r.uniform(55, 66);
+        }
+        else {
+            // hues well away from the target range
+            if (opt.red) b.hue = r.uniform(35, 150);
+            else b.hue = (r.uniform(0, 2) == 1) ? r.uniform(0, 35) : r.uniform(95, 160);
+        }
+
+        float reach = std::max(b.ax, b.ay);
+        b.x0 = r.uniform(reach, opt.width - reach);
+        b.y0 = r.uniform(reach, opt.height - reach);
+        b.vx = r.uniform(0.5f, 2.5f) * ((r.uniform(0, 2) == 1) ? 1 : -1);
+        b.vy = r.uniform(0.5f, 2.5f) * ((r.uniform(0, 2) == 1) ? 1 : -1);
+
+        bodies.push_back(b);
+    }
+
+    // dull background: all hues, low saturation, brightness gradient
+    background.create(opt.height, opt.width, CV_8UC3);
+
+    for (unsigned int y = 0; y < opt.height; y++) {
+        uchar* p = background.ptr<uchar>(y);
+        for (unsigned int x = 0; x < opt.width; x++) {
+            p[3*x] = (x * 180) / opt.width;
+            p[3*x+1] = 25;
+            p[3*x+2] = 90 + (70 * y) / opt.height;
+        }
+    }
+}
+
+float SyntheticScene::Bounce(float start, float speed, float f, float lo, float hi)
+{
+    float span = hi - lo;
+
+    if (span <= 0) return lo;
+
+    float p = fmod(start - lo + speed * f, 2 * span);
+    if (p < 0) p += 2 * span;
+
+    return lo + ((p > span) ? 2 * span - p : p);
+}
+
+void SyntheticScene::Render(unsigned int f, cv::Mat& bgr, std::vector<Truth>& truth)
+{
+    background.copyTo(hsv);
+    truth.clear();
+
+    double light = 1.0 + opt.drift * sin(2 * SCENE_PI * f / SCENE_DRIFT_PERIOD);
+    int val = std::min(255, (int) (SCENE_VAL * light));
+
+    unsigned int id = 0;
+
+    for (unsigned int k = 0; k < bodies.size(); k++) {
+
+        const Body& b = bodies[k];
+        float reach = std::max(b.ax, b.ay);
+
+        float x = Bounce(b.x0, b.vx, f, reach, opt.width - reach);
+        float y = Bounce(b.y0, b.vy, f, reach, opt.height - reach);
+
+        cv::ellipse(hsv, cv::Point(x, y), cv::Size(b.ax, b.ay), b.angle, 0, 360, cv::Scalar(b.hue, SCENE_SAT, val), cv::FILLED, 8);
+
+        if (b.target) {
+            Truth t = { ++id, x, y, (float) (SCENE_PI * b.ax * b.ay) };
+            truth.push_back(t);
+        }
+    }
+
+    cv::cvtColor(hsv, bgr, cv::COLOR_HSV2BGR);
+
+    if (opt.noise > 0) {
+        rng = cv::RNG(opt.seed + f); /* same noise for the same frame */
+        noise.create(bgr.size(), CV_16SC3);
+        rng.fill(noise, cv::RNG::NORMAL, 0, opt.noise);
+
+        cv::Mat wide;
+        bgr.convertTo(wide, CV_16SC3);
+        wide += noise;
+        wide.convertTo(bgr, CV_8UC3); /* saturates to 0..255 */
+    }
+}
+
+void SyntheticScene::Range(int range[6]) const
+{
+    range[0] = opt.red ? 170 : 50;  /* red wraps around: 170..179 and 0..10 */
+    range[1] = opt.red ? 10 : 70;
+    range[2] = 100;
+    range[3] = 255;
+    range[4] = 50;
+    range[5] = 255;
+}
@@ -0,0 +1,78 @@
+/*
+ * File name: SyntheticScene.hpp
+ * File description: Deterministic synthetic scenes with ground truth, used by bench.
+ *
+ */
+
+#ifndef _SyntheticScene_HPP_
+#define _SyntheticScene_HPP_
+
+#include "opencv2/core/core.hpp"
+
+#include <stdint.h>
+#include <vector>
+
+/*
+ * A scene is a set of coloured discs and ellipses bouncing around a dull,
+ * low-saturation background. Target objects carry the hue the tracker looks
+ * for, distractors carry other hues and must never be reported. Everything
+ * is derived from the seed, so a scene renders the same on every build.
+ */
+class SyntheticScene
+{
+    public:
+
+    struct Options
+    {
+        unsigned int width;
+        unsigned int height;
+        unsigned int targets;       // objects with the tracked hue
+        unsigned int distractors;   // objects with other hues
+        bool red;                   // targets straddle hue 0/179 (hue-wrapping threshold)
+        double noise;               // sigma of gaussian pixel noise
+        double drift;               // relative amplitude of the brightness drift
+        uint64_t seed;
+    };
+
+    // position of one target object in one frame
+    struct Truth
+    {
+        unsigned int id;    // 1.. in order of creation
+        float x;
+        float y;
+        float area;
+    };
+
+    SyntheticScene(const Options& options);
+
+    // draw frame f and list the targets that are fully inside it
+    void Render(unsigned int f, cv::Mat& bgr, std::vector<Truth>& truth);
+
+    // threshold range (as in -hue -sat -val) that selects the targets
+    void Range(int hsv[6]) const;
+
+    private:
+
+    struct Body
+    {
+        bool target;
+        bool ellipse;
+        int hue;
+        float x0, y0;   // start position
+        float vx, vy;   // speed, px per frame
+        float ax, ay;   // radii (equal for discs)
+        float angle;    // ellipse orientation, degrees
+    };
+
+    Options opt;
+    std::vector<Body> bodies;
+    cv::Mat background;     // HSV
+    cv::Mat hsv;            // scratch buffers
+    cv::Mat noise;
+    cv::RNG rng;            // noise generator, reseeded every frame
+
+    // position along a path that bounces between lo and hi
+    static float Bounce(float start, float speed, float f, float lo, float hi);
+};
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * File name: TileMap.cpp
+ * File description: Implementation of TileMap class.
+ *
+ */
+
+#include "TileMap.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+// OR of 8 bytes at a time without early exit, the compiler turns this into vector code
+static inline bool AnyNonZero(const uchar* p, int n)
+{
+    uint64_t acc = 0;
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        acc |= w;
+    }
+    for (; i < n; i++) acc |= p[i];
+
+    return acc != 0;
+}
+
+void TileMap::Reset(cv::Size frame)
+{
+    size = frame;
+    tilesx = (frame.width + TILE_SIZE - 1) >> TILE_SHIFT;
+    tilesy = (frame.height + TILE_SIZE - 1) >> TILE_SHIFT;
+    words = (tilesx + 63) >> 6;
+
+    bits.assign(words * tilesy, 0);
+}
+
+void TileMap::MarkRow(int y, const uchar* row)
+{
+    int ty = y >> TILE_SHIFT;
+
+    for (int tx = 0; tx < tilesx; tx++) {
+
+        if (occupied(tx, ty)) continue; /* an earlier row already found something */
+
+        int x = tx << TILE_SHIFT;
+        if (AnyNonZero(row + x, std::min(TILE_SIZE, size.width - x))) set(tx, ty);
+    }
+}
+
+unsigned int TileMap::count() const
+{
+    unsigned int n = 0;
+
+    for (int ty = 0; ty < tilesy; ty++) {
+        for (int tx = 0; tx < tilesx; tx++) n += occupied(tx, ty);
+    }
+
+    return n;
+}
+
+// rectangles in tile units that overlap or share an edge
+static bool Touch(const cv::Rect& a, const cv::Rect& b)
+{
+    return a.x <= b.x + b.width && b.x <= a.x + a.width && a.y <= b.y + b.height && b.y <= a.y + a.height;
+}
+
+bool TileMap::Regions(std::vector<cv::Rect>& regions) const
+{
+    std::vector<cv::Rect> boxes; // tile units
+
+    regions.clear();
+
+    // runs of occupied tiles per row, grown by one tile on every side
+    for (int ty = 0; ty < tilesy; ty++) {
+        for (int tx = 0; tx < tilesx; tx++) {
+
+            if (!occupied(tx, ty)) continue;
+
+            int end = tx;
+            while (end + 1 < tilesx && occupied(end + 1, ty)) end++;
+
+            cv::Rect box(tx - 1, ty - 1, end - tx + 3, 3);
+
+            // merge until no two boxes touch, so regions can be processed independently
+            for (unsigned int j = 0; j < boxes.size(); ) {
+                if (Touch(box, boxes[j])) {
+                    box |= boxes[j];
+                    boxes.erase(boxes.begin() + j);
+                    j = 0;
+                }
+                else j++;
+            }
+
+            boxes.push_back(box);
+            tx = end;
+        }
+    }
+
+    cv::Rect frame(cv::Point(0, 0), size);
+    double area = 0;
+
+    for (unsigned int i = 0; i < boxes.size(); i++) {
+
+        const cv::Rect& b = boxes[i];
+        cv::Rect r = cv::Rect(b.x * TILE_SIZE, b.y * TILE_SIZE, b.width * TILE_SIZE, b.height * TILE_SIZE) & frame;
+
+        area += r.area();
+        regions.push_back(r);
+    }
+
+    return area <= TILE_DENSE_LIMIT * frame.area();
+}
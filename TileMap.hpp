@@ -0,0 +1,57 @@
+/*
+ * File name: TileMap.hpp
+ * File description: Coarse occupancy bitmap of a binary mask, one bit per tile.
+ *
+ */
+
+#ifndef _TileMap_HPP_
+#define _TileMap_HPP_
+
+#define TILE_SHIFT 5            // 32x32 pixel tiles
+#define TILE_SIZE (1 << TILE_SHIFT)
+#define TILE_DENSE_LIMIT 0.5    // above this share of the frame, sparse processing doesn't pay off
+
+#include "opencv2/core/core.hpp"
+
+#include <vector>
+#include <stdint.h>
+
+/*
+ * Thresholding marks every row of the mask with MarkRow(), so the map is
+ * ready as soon as the mask is. Morphology and contour search then only
+ * visit Regions(): occupied tiles plus one tile around them, merged into
+ * rectangles that don't touch each other. A nonzero pixel is always at least
+ * one tile away from the edge of its region, further than morphology reaches,
+ * so processing the regions gives exactly the same result as the whole frame.
+ */
+class TileMap
+{
+    public:
+
+    TileMap() : tilesx(0), tilesy(0), words(0) {}
+
+    // clear all tiles, sized for a frame
+    void Reset(cv::Size frame);
+
+    // mark the tiles of row y that contain a nonzero pixel, row holds frame.width bytes
+    void MarkRow(int y, const uchar* row);
+
+    bool occupied(int tx, int ty) const { return (bits[ty * words + (tx >> 6)] >> (tx & 63)) & 1; }
+
+    unsigned int count() const; /* occupied tiles */
+
+    // regions to process in pixel coordinates, false if they would cover most of the frame
+    bool Regions(std::vector<cv::Rect>& regions) const;
+
+    private:
+
+    cv::Size size;
+    int tilesx;
+    int tilesy;
+    int words;                  // uint64_t per row of tiles
+    std::vector<uint64_t> bits;
+
+    void set(int tx, int ty) { bits[ty * words + (tx >> 6)] |= (uint64_t) 1 << (tx & 63); }
+};
+
+#endif
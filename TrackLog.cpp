@@ -0,0 +1,368 @@
+/*
+ * File name: TrackLog.cpp
+ * File description: Implementation of TrackLogWriter and TrackLogReader classes.
+ *
+ */
+
+#include "TrackLog.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+
+/** Includes for memory mapping **/
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace tracklog;
+
+/***************************** Writer *********************************/
+bool TrackLogWriter::Open(const char* path)
+{
+    Close();
+
+    file = fopen(path, "r+b"); /* a restart continues the existing log */
+    if (file == NULL) file = fopen(path, "w+b");
+    if (file == NULL) return false;
+
+    setvbuf(file, NULL, _IOFBF, TRACKLOG_BLOCK);
+
+    if (!Resume()) { /* not a track log (or another block size), left alone */
+        fclose(file);
+        file = NULL;
+        return false;
+    }
+
+    pending.clear();
+    pending.reserve(TRACKLOG_BLOCK * 4); /* steady state runs without allocating */
+    dropped = 0;
+    truncated = 0;
+
+    running = true;
+    worker = std::thread(&TrackLogWriter::Run, this);
+
+    return true;
+}
+
+bool TrackLogWriter::Resume()
+{
+    int fd = fileno(file);
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) return false;
+
+    blockno = 0;
+    blockused = 0;
+
+    if (st.st_size == 0) { /* new file */
+
+        FileHeader fh;
+        memset(&fh, 0, sizeof(fh));
+        strncpy(fh.magic, TRACKLOG_MAGIC, sizeof(fh.magic));
+        fh.version = TRACKLOG_VERSION;
+        fh.blocksize = TRACKLOG_BLOCK;
+        fh.created = std::chrono::duration_cast<std::chrono::milliseconds>
+                     (std::chrono::system_clock::now().time_since_epoch()).count();
+
+        return fwrite(&fh, sizeof(fh), 1, file) == 1;
+    }
+
+    FileHeader fh;
+    if (pread(fd, &fh, sizeof(fh), 0) != sizeof(fh)) return false;
+    if (strncmp(fh.magic, TRACKLOG_MAGIC, sizeof(fh.magic)) || fh.version != TRACKLOG_VERSION || fh.blocksize != TRACKLOG_BLOCK) return false;
+
+    size_t length = st.st_size;
+    size_t end = TRACKLOG_HEADER; /* everything before this is kept */
+
+    if (length > TRACKLOG_HEADER) {
+
+        // last block the previous run started, blocks before it are complete
+        uint32_t b = (length - TRACKLOG_HEADER - 1) / TRACKLOG_BLOCK;
+        size_t base = TRACKLOG_HEADER + (size_t) b * TRACKLOG_BLOCK;
+        size_t avail = std::min((size_t) TRACKLOG_BLOCK, length - base);
+
+        std::vector<char> data(avail);
+        const BlockHeader* bh = (const BlockHeader*) &data[0];
+
+        if (pread(fd, &data[0], avail, base) != (ssize_t) avail) return false;
+
+        blockno = b;
+        end = base;
+
+        if (avail >= sizeof(BlockHeader) && bh->magic == TRACKLOG_BLOCK_MAGIC && bh->block == b) {
+
+            // walk the frames, the first one cut short (or the padding) ends the block
+            size_t at = sizeof(BlockHeader);
+
+            while (at + sizeof(FrameHeader) <= avail) {
+
+                const FrameHeader* h = (const FrameHeader*) &data[at];
+
+                if (h->size == 0 || h->size != sizeof(FrameHeader) + h->count * sizeof(TrackRecord) || at + h->size > avail) break;
+
+                at += h->size;
+            }
+
+            if (at + sizeof(FrameHeader) <= avail && ((const FrameHeader*) &data[at])->size == 0 && avail == TRACKLOG_BLOCK) {
+                blockno = b + 1; /* padded out, the next frame opens a new block */
+                end = base + TRACKLOG_BLOCK;
+            }
+            else {
+                blockused = at;
+                end = base + at;
+            }
+        }
+        /* else: the header of the last block was cut short, that block is written again */
+    }
+
+    // drop the torn tail, appending continues right after the last complete frame
+    if (end != length && ftruncate(fd, end) < 0) return false;
+
+    return fseek(file, 0, SEEK_END) == 0;
+}
+
+void TrackLogWriter::Close()
+{
+    if (file == NULL) return;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running = false;
+    }
+    wake.notify_one();
+    worker.join(); /* writes out whatever is still queued */
+
+    fclose(file);
+    file = NULL;
+}
+
+void TrackLogWriter::Write(uint32_t frame, int64_t t, const TrackStore& obj, unsigned int minlife)
+{
+    if (file == NULL) return;
+
+    unsigned int n = obj.size();
+    unsigned int maxn = (TRACKLOG_BLOCK - sizeof(BlockHeader) - sizeof(FrameHeader)) / sizeof(TrackRecord);
+    uint32_t flags = 0;
+
+    if (n > maxn) { /* a frame has to fit in one block, the rest of the tracks is left out */
+        n = maxn;
+        flags = FRAME_TRUNCATED;
+        truncated++;
+    }
+
+    size_t len = sizeof(FrameHeader) + n * sizeof(TrackRecord);
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        if (pending.size() + len > TRACKLOG_MAX_PENDING) { /* disk can't keep up */
+            dropped++;
+            return;
+        }
+
+        size_t at = pending.size();
+        pending.resize(at + len);
+
+        FrameHeader* h = (FrameHeader*) &pending[at];
+        h->size = len;
+        h->frame = frame;
+        h->t = t;
+        h->count = n;
+        h->flags = flags;
+
+        TrackRecord* r = (TrackRecord*) (h + 1);
+        for (unsigned int i = 0; i < n; i++) {
+            r[i].id = obj.id(i);
+            r[i].x = obj.x[i];
+            r[i].y = obj.y[i];
+            r[i].area = obj.area[i];
+            r[i].life = obj.lifecnt[i];
+            r[i].flags = (obj.lifecnt[i] >= minlife) ? TRACK_CONFIRMED : 0;
+        }
+    }
+
+    wake.notify_one();
+}
+
+void TrackLogWriter::Run()
+{
+    std::vector<char> batch;
+    batch.reserve(pending.capacity());
+
+    std::unique_lock<std::mutex> guard(lock);
+
+    while (running || !pending.empty()) {
+
+        if (pending.empty()) {
+            wake.wait(guard);
+            continue;
+        }
+
+        batch.swap(pending); /* Write() carries on filling the other buffer */
+        guard.unlock();
+
+        Append(batch.data(), batch.size());
+        batch.clear();
+        fflush(file);
+
+        guard.lock();
+    }
+}
+
+void TrackLogWriter::Append(const char* frames, size_t len)
+{
+    static const char zeros[TRACKLOG_BLOCK] = {0};
+
+    for (size_t at = 0; at < len; ) {
+
+        const FrameHeader* h = (const FrameHeader*) (frames + at);
+
+        // frame doesn't fit: pad the block out, a zero size marks its end
+        if (blockused > 0 && blockused + h->size > TRACKLOG_BLOCK) {
+            fwrite(zeros, TRACKLOG_BLOCK - blockused, 1, file);
+            blockno++;
+            blockused = 0;
+        }
+
+        // every block opens with its index entry
+        if (blockused == 0) {
+            BlockHeader bh = { TRACKLOG_BLOCK_MAGIC, blockno, h->t, h->frame, 0 };
+            fwrite(&bh, sizeof(bh), 1, file);
+            blockused = sizeof(bh);
+        }
+
+        fwrite(h, h->size, 1, file);
+        blockused += h->size;
+        at += h->size;
+    }
+}
+/**********************************************************************/
+
+
+/***************************** Reader *********************************/
+bool TrackLogReader::Open(const char* path)
+{
+    Close();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t) st.st_size < TRACKLOG_HEADER) {
+        close(fd);
+        return false;
+    }
+
+    void* m = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); /* mapping stays valid */
+
+    if (m == MAP_FAILED) return false;
+
+    map = (const char*) m;
+    length = st.st_size;
+
+    const FileHeader* fh = (const FileHeader*) map;
+
+    if (strncmp(fh->magic, TRACKLOG_MAGIC, sizeof(fh->magic)) || fh->version != TRACKLOG_VERSION || fh->blocksize < sizeof(BlockHeader) + sizeof(FrameHeader)) {
+        Close();
+        return false;
+    }
+
+    blocksize = fh->blocksize;
+    nblocks = (length - TRACKLOG_HEADER + blocksize - 1) / blocksize;
+
+    while (nblocks > 0 && blockHeader(nblocks - 1) == NULL) nblocks--; /* header of last block cut short */
+
+    Rewind();
+
+    return true;
+}
+
+void TrackLogReader::Close()
+{
+    if (map != NULL) munmap((void*) map, length);
+
+    map = NULL;
+    length = 0;
+    nblocks = 0;
+}
+
+const BlockHeader* TrackLogReader::blockHeader(unsigned int b) const
+{
+    size_t at = TRACKLOG_HEADER + (size_t) b * blocksize;
+
+    if (at + sizeof(BlockHeader) > length) return NULL;
+
+    const BlockHeader* bh = (const BlockHeader*) (map + at);
+
+    return (bh->magic == TRACKLOG_BLOCK_MAGIC) ? bh : NULL;
+}
+
+void TrackLogReader::Rewind()
+{
+    block = 0;
+    offset = sizeof(BlockHeader);
+}
+
+bool TrackLogReader::Seek(int64_t t)
+{
+    if (nblocks == 0) return false;
+
+    // last block starting at or before t, blocks are in time order
+    unsigned int lo = 0, hi = nblocks - 1;
+
+    while (lo < hi) {
+        unsigned int mid = (lo + hi + 1) / 2;
+        const BlockHeader* bh = blockHeader(mid);
+
+        if (bh != NULL && bh->t <= t) lo = mid;
+        else hi = mid - 1;
+    }
+
+    block = lo;
+    offset = sizeof(BlockHeader);
+
+    // short scan within the block for the first frame at or after t
+    Frame f;
+    for (;;) {
+        unsigned int b = block;
+        size_t o = offset;
+
+        if (!Next(f)) return false;
+
+        if (f.header->t >= t) {
+            block = b;
+            offset = o;
+            return true;
+        }
+    }
+}
+
+bool TrackLogReader::Next(Frame& f)
+{
+    while (block < nblocks) {
+
+        size_t base = TRACKLOG_HEADER + (size_t) block * blocksize;
+        size_t end = std::min((size_t) blocksize, length - base); /* last block may be partial */
+
+        if (blockHeader(block) != NULL && offset + sizeof(FrameHeader) <= end) {
+
+            const FrameHeader* h = (const FrameHeader*) (map + base + offset);
+
+            if (h->size == sizeof(FrameHeader) + h->count * sizeof(TrackRecord) && offset + h->size <= end) {
+                f.header = h;
+                f.tracks = (const TrackRecord*) (h + 1);
+                offset += h->size;
+                return true;
+            }
+        }
+
+        block++; /* end of block (padding, or the end of the file) */
+        offset = sizeof(BlockHeader);
+    }
+
+    return false;
+}
+/**********************************************************************/
@@ -0,0 +1,166 @@
+/*
+ * File name: TrackLog.hpp
+ * File description: Append-only binary recording of tracked objects and its reader.
+ *
+ */
+
+#ifndef _TrackLog_HPP_
+#define _TrackLog_HPP_
+
+#define TRACKLOG_MAGIC "PCTLOG1"
+#define TRACKLOG_VERSION 1
+#define TRACKLOG_HEADER 64          // file header size, blocks start right after it
+#define TRACKLOG_BLOCK 65536        // block size, every block starts with a time/frame index entry
+#define TRACKLOG_BLOCK_MAGIC 0x42544350 // "PCTB"
+#define TRACKLOG_MAX_PENDING (4 << 20) // bytes waiting for the writer thread before frames get dropped
+
+#include "TrackStore.hpp"
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+ * File layout (native byte order, every record 8-byte aligned):
+ *
+ *   [file header, 64 bytes][block 0][block 1]...
+ *
+ * Each block is TRACKLOG_BLOCK bytes and begins with a BlockHeader carrying
+ * the time and number of its first frame, which makes the block headers a
+ * sorted index that can be binary searched in place. Frames never straddle a
+ * block; a FrameHeader with size 0 (or the end of the file) ends a block.
+ * A crash loses at most what was still queued for the writer thread, the
+ * file stays readable up to the last complete frame. Reopening the file
+ * cuts off a torn frame or block header and appends after the last complete
+ * frame, with block numbering carried on. Frame numbers restart at 0 with
+ * every run, times keep growing.
+ */
+namespace tracklog
+{
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t blocksize;
+        int64_t created;    // ms since epoch
+        char reserved[TRACKLOG_HEADER - 24];
+    };
+
+    struct BlockHeader
+    {
+        uint32_t magic;
+        uint32_t block;     // block number
+        int64_t t;          // time of first frame in block, ms since epoch
+        uint32_t frame;     // number of first frame in block
+        uint32_t reserved;
+    };
+
+    struct FrameHeader
+    {
+        uint32_t size;      // bytes including this header, 0 marks the end of a block
+        uint32_t frame;     // frame number since the tracker started
+        int64_t t;          // capture time, ms since epoch
+        uint32_t count;     // amount of TrackRecords following the header
+        uint32_t flags;     // FRAME_TRUNCATED when tracks had to be left out
+    };
+
+    struct TrackRecord
+    {
+        uint32_t id;
+        int16_t x;
+        int16_t y;
+        int32_t area;
+        uint16_t life;
+        uint16_t flags;     // TRACK_CONFIRMED when the object is reported to clients
+    };
+
+    enum { TRACK_CONFIRMED = 1 };
+    enum { FRAME_TRUNCATED = 1 };
+}
+
+class TrackLogWriter
+{
+    public:
+
+    TrackLogWriter() : file(NULL), running(false), dropped(0), truncated(0) {}
+    ~TrackLogWriter() { Close(); }
+
+    // create the log file, or continue an existing one after its last complete frame, and start the writer thread
+    bool Open(const char* path);
+    void Close();
+
+    bool isOpen() const { return file != NULL; }
+
+    // queue one frame of tracked objects, never blocks on disk
+    void Write(uint32_t frame, int64_t t, const TrackStore& obj, unsigned int minlife);
+
+    unsigned long droppedFrames() const { return dropped; }     // not written, the queue was full
+    unsigned long truncatedFrames() const { return truncated; } // written without the tracks that didn't fit a block
+
+    private:
+
+    FILE* file;
+    std::thread worker;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool running;
+
+    std::vector<char> pending;  // frames queued by Write()
+    std::atomic<unsigned long> dropped;
+    std::atomic<unsigned long> truncated;
+
+    uint32_t blockno;           // block currently being filled
+    uint32_t blockused;         // bytes used in current block
+
+    bool Resume();  // write the file header, or find where the last run stopped and cut off what it left torn
+    void Run();
+    void Append(const char* frames, size_t len);
+};
+
+class TrackLogReader
+{
+    public:
+
+    // view of one frame inside the mapped file
+    struct Frame
+    {
+        const tracklog::FrameHeader* header;
+        const tracklog::TrackRecord* tracks;
+    };
+
+    TrackLogReader() : map(NULL), length(0), blocksize(0), nblocks(0), block(0), offset(0) {}
+    ~TrackLogReader() { Close(); }
+
+    bool Open(const char* path);
+    void Close();
+
+    // position at the first frame recorded at or after time t (binary search over blocks)
+    bool Seek(int64_t t);
+
+    // rewind to the first frame of the file
+    void Rewind();
+
+    // return the frame at current position and move past it, false at end of file
+    bool Next(Frame& f);
+
+    unsigned int blocks() const { return nblocks; }
+
+    private:
+
+    const char* map;
+    size_t length;
+    uint32_t blocksize;
+    unsigned int nblocks;
+
+    unsigned int block;     // current position: block number
+    size_t offset;          // and offset within that block
+
+    const tracklog::BlockHeader* blockHeader(unsigned int b) const;
+};
+
+#endif
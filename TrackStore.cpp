@@ -0,0 +1,180 @@
+/*
+ * File name: TrackStore.cpp
+ * File description: Implementation of TrackStore class.
+ *
+ */
+
+#include "TrackStore.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+void TrackStore::Init(unsigned int capacity, unsigned int historydepth)
+{
+    cap = capacity;
+    histdepth = historydepth;
+    count = 0;
+    overflow = 0;
+    nextseq = 0;
+
+    x.assign(cap, 0);
+    y.assign(cap, 0);
+    area.assign(cap, 0);
+    cm.assign(cap, 0.0f);
+    removcnt.assign(cap, 0);
+    lifecnt.assign(cap, 0);
+    slot.assign(cap, INVALID_SLOT);
+    seq.assign(cap, 0);
+
+    ids.assign(cap, 0);
+    colour.assign(cap * 6, 0);
+    gen.assign(cap, 0);
+    dense.assign(cap, INVALID_SLOT);
+
+    HistoryPoint empty = { 0, 0, 0, 0 };
+    hist.assign(cap * histdepth, empty);
+    histhead.assign(cap, 0);
+    histcount.assign(cap, 0);
+
+    freelist.resize(cap);
+    for (unsigned int i = 0; i < cap; i++) freelist[i] = cap - 1 - i; /* lowest slots are handed out first */
+}
+
+void TrackStore::Clear()
+{
+    while (count > 0) Remove(count - 1);
+}
+
+TrackStore::Handle TrackStore::Insert(unsigned int id, int newx, int newy, int newarea, unsigned int rmdef, const int hsv[])
+{
+    Handle h = { INVALID_SLOT, 0 };
+
+    if (count == cap) { /* overflow policy: refuse the new track, keep the existing ones */
+        overflow++;
+        return h;
+    }
+
+    uint32_t s = freelist.back();
+    freelist.pop_back();
+
+    unsigned int i = count++;
+
+    x[i] = newx;
+    y[i] = newy;
+    area[i] = newarea;
+    cm[i] = (sqrt(newarea))/2;
+    removcnt[i] = rmdef;
+    lifecnt[i] = 0;
+    slot[i] = s;
+    seq[i] = nextseq++;
+
+    dense[s] = i;
+    ids[s] = id;
+    for (unsigned int k = 0; k < 6; k++) colour[s * 6 + k] = hsv[k];
+
+    histhead[s] = 0;
+    histcount[s] = 0;
+
+    h.slot = s;
+    h.gen = gen[s];
+
+    return h;
+}
+
+void TrackStore::Remove(unsigned int i)
+{
+    if (i >= count) return;
+
+    uint32_t s = slot[i];
+    unsigned int last = --count;
+
+    if (i != last) { /* move the last track into the hole */
+        x[i] = x[last];
+        y[i] = y[last];
+        area[i] = area[last];
+        cm[i] = cm[last];
+        removcnt[i] = removcnt[last];
+        lifecnt[i] = lifecnt[last];
+        slot[i] = slot[last];
+        seq[i] = seq[last];
+
+        dense[slot[i]] = i;
+    }
+
+    slot[last] = INVALID_SLOT;
+
+    dense[s] = INVALID_SLOT;
+    gen[s]++;
+    freelist.push_back(s);
+}
+
+unsigned int TrackStore::RemoveExpired()
+{
+    unsigned int removed = 0;
+    unsigned int i = 0;
+
+    while (i < count) {
+        if (removcnt[i] == 0) {
+            Remove(i); /* the moved track is checked on the next pass */
+            removed++;
+        }
+        else i++;
+    }
+
+    return removed;
+}
+
+void TrackStore::InsertionOrder(std::vector<unsigned int>& order) const
+{
+    order.resize(count);
+    for (unsigned int i = 0; i < count; i++) order[i] = i;
+
+    // removals only move the last track, so this is nearly sorted already
+    const uint64_t* sq = seq.data();
+    std::sort(order.begin(), order.end(), [sq](unsigned int a, unsigned int b) { return sq[a] < sq[b]; });
+}
+
+int TrackStore::Find(Handle h) const
+{
+    if (h.slot >= cap || gen[h.slot] != h.gen || dense[h.slot] == INVALID_SLOT) return -1;
+
+    return dense[h.slot];
+}
+
+TrackStore::Handle TrackStore::handle(unsigned int i) const
+{
+    Handle h = { slot[i], gen[slot[i]] };
+
+    return h;
+}
+
+int TrackStore::FindId(unsigned int id) const
+{
+    for (unsigned int i = 0; i < count; i++) {
+        if (ids[slot[i]] == id) return i;
+    }
+
+    return -1;
+}
+
+void TrackStore::Record(unsigned int i, int64_t t, int px, int py, int parea)
+{
+    uint32_t s = slot[i];
+    HistoryPoint& p = hist[s * histdepth + histhead[s]];
+
+    p.t = t;
+    p.x = px;
+    p.y = py;
+    p.area = parea;
+
+    histhead[s] = (histhead[s] + 1) % histdepth; /* oldest entry gets overwritten when full */
+    if (histcount[s] < histdepth) histcount[s]++;
+}
+
+const TrackStore::HistoryPoint& TrackStore::historyAt(unsigned int i, unsigned int k) const
+{
+    uint32_t s = slot[i];
+    unsigned int oldest = (histhead[s] + histdepth - histcount[s]) % histdepth;
+
+    return hist[s * histdepth + (oldest + k) % histdepth];
+}
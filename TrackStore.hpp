@@ -0,0 +1,131 @@
+/*
+ * File name: TrackStore.hpp
+ * File description: Structure-of-arrays storage for tracked objects.
+ *
+ */
+
+#ifndef _TrackStore_HPP_
+#define _TrackStore_HPP_
+
+#define MAX_TRACKS 256   // default capacity of the track store
+#define MAX_TRACKS_LIMIT 4096
+#define HISTORY_DEPTH 32   // default amount of positions kept per track
+#define MAX_HISTORY_DEPTH 1024
+#define INVALID_SLOT 0xFFFFFFFF
+
+#include <vector>
+#include <stdint.h>
+
+/*
+ * Live tracks are packed densely at [0, size()) of the hot arrays, so the
+ * association and serialisation loops walk plain contiguous memory. Removal
+ * moves the last track into the hole instead of shifting every survivor.
+ * Every track carries an insertion sequence number; output that has to list
+ * tracks in the order they appeared sorts by it (InsertionOrder()).
+ *
+ * Cold metadata (ID, colour range) lives per slot. A slot keeps its place for
+ * the whole lifetime of a track, and a Handle (slot + generation) stays valid
+ * until that track is removed, no matter how the dense arrays get reordered.
+ *
+ * Capacity is fixed by Init(). When the store is full, new tracks are refused
+ * and counted in overflows(); existing tracks are never evicted.
+ *
+ * Every slot also owns a ring of the last 'depth' recorded positions. All rings
+ * are allocated by Init(), so memory use is capacity x depth and recording
+ * never allocates.
+ */
+class TrackStore
+{
+    public:
+
+    struct Handle
+    {
+        uint32_t slot;
+        uint32_t gen;
+    };
+
+    struct HistoryPoint
+    {
+        int64_t t;  // timestamp, ms since epoch
+        int x;
+        int y;
+        int area;
+    };
+
+    /************************ hot data (dense) ************************/
+    std::vector<int> x;                 // x coord
+    std::vector<int> y;                 // y coord
+    std::vector<int> area;              // area value
+    std::vector<float> cm;              // coordinate margin
+    std::vector<unsigned int> removcnt; // if this reaches 0, the object is removed
+    std::vector<unsigned int> lifecnt;  // amount of cycles the object has existed
+    std::vector<uint32_t> slot;         // slot of the track at each dense position
+    std::vector<uint64_t> seq;          // insertion sequence number, grows with every Insert()
+
+    TrackStore() { Init(MAX_TRACKS, HISTORY_DEPTH); }
+
+    // allocate storage for a fixed amount of tracks and history, drops all existing tracks
+    void Init(unsigned int capacity, unsigned int historydepth);
+
+    // remove all tracks, generations move on so old handles become invalid
+    void Clear();
+
+    // add a track; returns a handle with slot INVALID_SLOT if the store is full
+    Handle Insert(unsigned int id, int newx, int newy, int newarea, unsigned int rmdef, const int hsv[]);
+
+    // remove the track at dense position i, the last track takes its place
+    void Remove(unsigned int i);
+
+    // remove every track whose removal counter has reached 0
+    unsigned int RemoveExpired();
+
+    // dense positions of all tracks, oldest insertion first
+    void InsertionOrder(std::vector<unsigned int>& order) const;
+
+    // dense position of a live track, -1 if the handle is stale
+    int Find(Handle h) const;
+
+    Handle handle(unsigned int i) const;
+
+    // dense position of the track with given ID, -1 if there is none
+    int FindId(unsigned int id) const;
+
+    // append a position to the history of the track at dense position i
+    void Record(unsigned int i, int64_t t, int px, int py, int parea);
+
+    // recorded positions of the track at dense position i, k = 0 is the oldest
+    unsigned int historySize(unsigned int i) const { return histcount[slot[i]]; }
+    const HistoryPoint& historyAt(unsigned int i, unsigned int k) const;
+
+    /*********************** cold data (per slot) *********************/
+    unsigned int id(unsigned int i) const { return ids[slot[i]]; }
+    const int* hsv(unsigned int i) const { return &colour[slot[i] * 6]; }
+
+    unsigned int size() const { return count; }
+    unsigned int capacity() const { return cap; }
+    unsigned int depth() const { return histdepth; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == cap; }
+
+    unsigned long overflows() const { return overflow; }
+
+    private:
+
+    unsigned int count;
+    unsigned int cap;
+    unsigned long overflow;     // tracks refused because the store was full
+    uint64_t nextseq;           // sequence number of the next inserted track
+
+    std::vector<unsigned int> ids;  // object index
+    std::vector<int> colour;        // lhue, hhue, lsat, hsat, lval, hval
+    std::vector<uint32_t> gen;      // bumped every time a slot is released
+    std::vector<uint32_t> dense;    // dense position of each occupied slot
+    std::vector<uint32_t> freelist; // stack of unoccupied slots
+
+    unsigned int histdepth;
+    std::vector<HistoryPoint> hist;     // histdepth entries per slot
+    std::vector<unsigned int> histhead; // next write position in the ring of each slot
+    std::vector<unsigned int> histcount;
+};
+
+#endif
@@ -0,0 +1,173 @@
+/*
+ * File name: TrackerConfig.cpp
+ * File description: Implementation of TrackerConfig and ConfigBuilder.
+ *
+ */
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "ColourTracking.hpp"
+#include "TrackerConfig.hpp"
+#include "ColourMath.hpp"
+#include "StateFile.hpp"
+
+bool TrackerParams::operator==(const TrackerParams& o) const
+{
+    for (int i = 0; i < 6; i++) {
+        if (hsv[i] != o.hsv[i]) return false;
+    }
+
+    return minsize == o.minsize && maxsize == o.maxsize && morph == o.morph && blur == o.blur && rmdefault == o.rmdefault && format == o.format;
+}
+
+void TrackerConfig::Build(const unsigned char* yuvtable)
+{
+    kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(MORPH_KERNEL_SIZE, MORPH_KERNEL_SIZE));
+    
+    variant = ThresholdVariant(p.hsv, p.blur);
+    thresholdKernel = SelectThreshold(variant);
+    morphKernel = (MORPH_KERNEL_SIZE == 3) ? SelectMorph(p.morph) : NULL; /* the kernels only know the cross */
+    
+    if (p.format == INPUT_BGR) return;
+    
+    if (yuvtable != NULL) yuvTable.assign(yuvtable, yuvtable + YUV_TABLE_BYTES); /* saved by a previous run */
+    else BuildYuvTable();
+}
+
+void TrackerConfig::BuildYuvTable()
+{
+    const HsvDivTables& t = hsvDiv();
+    
+    yuvTable.assign(YUV_TABLE_BYTES, 0);
+    
+    // every (U, V) pair against 64 brightness steps, each step stands for Y..Y+3
+    for (int u = 0; u < 256; u++) {
+        for (int v = 0; v < 256; v++) {
+            for (int yq = 0; yq < 64; yq++) {
+                
+                int b, g, r, h, s, val;
+                
+                YuvToBgr((yq << 2) + 2, u, v, b, g, r);
+                BgrToHsv(b, g, r, h, s, val, t);
+                
+                if (InRangeHsv(h, s, val, p.hsv)) {
+                    unsigned int i = (yq << 16) | (u << 8) | v;
+                    yuvTable[i >> 3] |= 1 << (i & 7);
+                }
+            }
+        }
+    }
+}
+
+/**************************** Builder *********************************/
+void ConfigBuilder::Start()
+{
+    if (running) return;
+
+    running = true;
+    worker = std::thread(&ConfigBuilder::Run, this);
+}
+
+void ConfigBuilder::Stop()
+{
+    if (!running) return;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running = false;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+void ConfigBuilder::Request(const TrackerParams& params)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        request = params;
+        queued = true;
+    }
+    wake.notify_one();
+}
+
+std::shared_ptr<const TrackerConfig> ConfigBuilder::Take()
+{
+    return std::atomic_exchange(&ready, std::shared_ptr<const TrackerConfig>());
+}
+
+std::shared_ptr<const TrackerConfig> ConfigBuilder::Wait()
+{
+    {
+        std::unique_lock<std::mutex> guard(lock);
+
+        while (running && (queued || building)) idle.wait(guard);
+    }
+
+    return Take(); /* empty when nothing was on the way */
+}
+
+void ConfigBuilder::Adopted(const std::shared_ptr<const TrackerConfig>& next, std::shared_ptr<const TrackerConfig> old)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        adopted = next;
+        if (old) retired.push_back(std::move(old));
+    }
+    wake.notify_one();
+}
+
+std::shared_ptr<const TrackerConfig> ConfigBuilder::BuildNow(const TrackerParams& params, const unsigned char* yuvtable)
+{
+    std::shared_ptr<TrackerConfig> cfg = std::make_shared<TrackerConfig>();
+
+    cfg->p = params;
+    cfg->Build(yuvtable);
+
+    return cfg;
+}
+
+void ConfigBuilder::Run()
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    while (running) {
+
+        if (adopted || !retired.empty()) {
+
+            std::shared_ptr<const TrackerConfig> save;
+            save.swap(adopted);
+            releasing.swap(retired); /* retired gets the emptied vector back, no allocation on the frame loop */
+
+            guard.unlock();
+
+            if (save && statefile != NULL && save->p.format != INPUT_BGR) statefile->SaveTable(save->p.hsv, save->yuvTable);
+
+            releasing.clear(); /* old snapshots are freed here, usually the last reference */
+            save.reset();
+
+            guard.lock();
+            continue;
+        }
+
+        if (!queued) {
+            wake.wait(guard);
+            continue;
+        }
+
+        TrackerParams params = request;
+        queued = false;
+        building = true;
+
+        guard.unlock(); /* new requests can come in while building */
+
+        std::atomic_store(&ready, BuildNow(params, NULL)); /* picked up at the next frame boundary */
+
+        guard.lock();
+        building = false;
+        idle.notify_all();
+    }
+
+    idle.notify_all(); /* Wait() doesn't hang on a stopped builder */
+}
+/**********************************************************************/
@@ -0,0 +1,123 @@
+/*
+ * File name: TrackerConfig.hpp
+ * File description: Immutable processing configuration and its background builder.
+ *
+ */
+
+#ifndef _TrackerConfig_HPP_
+#define _TrackerConfig_HPP_
+
+#define YUV_TABLE_BYTES (1 << 19) // one bit for each (Y >> 2, U, V)
+
+#include "opencv2/core/core.hpp"
+#include "PixelKernels.hpp"
+
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class StateFile;
+
+// parameters that can be changed while running (CLI, trackbars or UDP control)
+struct TrackerParams
+{
+    int hsv[6];             // lhue, hhue, lsat, hsat, lval, hval
+    float minsize;          // limits for counting objects
+    float maxsize;
+    int morph;              // 0 - no morph, 1 - only erode, 2 - erode & dilate
+    bool blur;              // blur when thresholding
+    unsigned int rmdefault; // cycles before an undetected object is dropped
+    int format;             // INPUT_BGR, INPUT_YUYV or INPUT_NV12
+
+    bool operator==(const TrackerParams& o) const;
+    bool operator!=(const TrackerParams& o) const { return !(*this == o); }
+};
+
+/*
+ * One frame is processed with one TrackerConfig from start to end. A config
+ * is never changed after Build(), the frame loop only swaps the pointer
+ * between frames, so it can be read without locking.
+ */
+struct TrackerConfig
+{
+    TrackerParams p;
+
+    // derived state
+    cv::Mat kernel;         // structuring element used by MorphImage
+    int variant;            // KERNEL_* bits of thresholdKernel
+    ThresholdKernel thresholdKernel; // specialisations picked for p, see PixelKernels.hpp (-generic uses ThresholdImage and MorphImage instead)
+    MorphKernel morphKernel; // NULL when kernel isn't the 3x3 ellipse
+    std::vector<unsigned char> yuvTable; // YUV input only: bit set when the colour is inside the HSV range
+
+    // classify a YUV pixel with yuvTable
+    bool yuvMatch(int y, int u, int v) const
+    {
+        unsigned int i = ((y >> 2) << 16) | (u << 8) | v;
+        return (yuvTable[i >> 3] >> (i & 7)) & 1;
+    }
+
+    // fill in derived state from p; yuvtable is a table saved earlier for p.hsv, or NULL to build one
+    void Build(const unsigned char* yuvtable);
+    void BuildYuvTable();
+};
+
+/*
+ * Builds configs on a background thread. Request() queues parameters (only the
+ * newest request is kept), Take() hands the finished config to the frame loop
+ * without ever waiting for a build. Adopted() gives the thread the rest of a
+ * swap: the retired config (and its YUV table) is freed there, and the table
+ * of the new one is saved to the state file there.
+ */
+class ConfigBuilder
+{
+    public:
+
+    ConfigBuilder() : running(false), queued(false), building(false), statefile(NULL) {}
+    ~ConfigBuilder() { Stop(); }
+
+    void Start();
+    void Stop();
+
+    // queue parameters for building, replaces a request that hasn't started yet
+    void Request(const TrackerParams& params);
+
+    // newly built config, or an empty pointer if nothing new is ready
+    std::shared_ptr<const TrackerConfig> Take();
+
+    // like Take(), but waits for a request that is queued or being built (for the very first frame)
+    std::shared_ptr<const TrackerConfig> Wait();
+
+    // frame loop switched from old to next; pass old with std::move so the last reference ends up here
+    void Adopted(const std::shared_ptr<const TrackerConfig>& next, std::shared_ptr<const TrackerConfig> old);
+
+    // YUV tables of adopted configs are saved here (set before the first Adopted(), NULL to stop)
+    void SaveTables(StateFile* sf) { statefile = sf; }
+
+    // build on the calling thread, with a saved YUV table or NULL
+    static std::shared_ptr<const TrackerConfig> BuildNow(const TrackerParams& params, const unsigned char* yuvtable);
+
+    private:
+
+    std::thread worker;
+    std::mutex lock;            // guards the request and the handed over configs, never taken by Take()
+    std::condition_variable wake;
+    std::condition_variable idle; // signalled when a build finishes
+    bool running;
+
+    TrackerParams request;
+    bool queued;
+    bool building;
+
+    std::shared_ptr<const TrackerConfig> adopted;               // table still to be saved
+    std::vector<std::shared_ptr<const TrackerConfig> > retired; // still to be freed
+    std::vector<std::shared_ptr<const TrackerConfig> > releasing; // builder thread only, keeps its capacity
+    StateFile* statefile;
+
+    std::shared_ptr<const TrackerConfig> ready; // accessed with atomic_load/atomic_exchange only
+
+    void Run();
+};
+
+#endif
@@ -0,0 +1,497 @@
+/*
+ * File name: bench.cpp
+ * File description: Speed and tracking accuracy benchmark on synthetic scenes.
+ *
+ */
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "ColourTracking.hpp"
+#include "SyntheticScene.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdio>
+
+using namespace std::chrono;
+
+#define BENCH_FRAMES 200
+#define BENCH_SEED 12015
+#define BENCH_NOISE 6.0
+#define BENCH_DRIFT 0.25
+
+// friend of ColourTracking, times the private stages one by one
+class Bench
+{
+    public:
+
+    struct Stages
+    {
+        double threshold, morph, find, associate, serialise; // ns, summed over all frames
+        unsigned int sparse;    // frames that took the tile path
+        unsigned int mismatch;  // frames where the tile path found other objects than the whole frame
+    };
+
+    struct Accuracy
+    {
+        unsigned long truths;       // target objects scored
+        unsigned long matched;
+        unsigned long missed;       // target without a reported track
+        unsigned long falsetracks;  // reported track without a target
+        unsigned long switches;     // target matched to a different ID than before
+        double error;               // summed distance of matches, px
+    };
+
+    Bench(unsigned int f, int m, int fmt, bool t, bool b, bool g) : frames(f), morph(m), format(fmt), tiles(t), blur(b), generic(g) {}
+
+    // one scene in one mode, returns a JSON object
+    std::string Run(const SyntheticScene::Options& opt, const char* scene, unsigned int pyramid);
+    
+    // every threshold and morph specialisation against the generic path, returns a JSON object
+    std::string Kernels(const SyntheticScene::Options& opt);
+
+    private:
+
+    unsigned int frames;
+    int morph;
+    int format; /* INPUT_BGR, or INPUT_NV12 to time thresholding without conversion */
+    bool tiles; /* sparse morph and search around occupied tiles */
+    bool blur; /* blur when thresholding */
+    bool generic; /* threshold and morph without the specialised kernels (-generic) */
+
+    void Configure(ColourTracking& ct, const SyntheticScene& scene, const SyntheticScene::Options& opt, unsigned int pyramid);
+    void TimeStages(ColourTracking& ct, SyntheticScene& scene, Stages& st);
+    double TimePipeline(ColourTracking& ct, SyntheticScene& scene, Accuracy& acc);
+    void Frame(ColourTracking& ct, SyntheticScene& scene, unsigned int f, std::vector<SyntheticScene::Truth>& truth);
+    void Score(ColourTracking& ct, const std::vector<SyntheticScene::Truth>& truth, std::map<unsigned int, unsigned int>& ids, Accuracy& acc);
+
+    static double ns(steady_clock::time_point a, steady_clock::time_point b) { return duration_cast<nanoseconds>(b - a).count(); }
+};
+
+static std::string num(double v)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.4g", v);
+    return buf;
+}
+
+void Bench::Configure(ColourTracking& ct, const SyntheticScene& scene, const SyntheticScene::Options& opt, unsigned int pyramid)
+{
+    ct.bGUI = false;
+    ct.iDebugLevel = 0;
+    ct.iMorphLevel = morph;
+    ct.uiPyramid = pyramid;
+    ct.iInputFormat = format;
+    ct.bSparse = tiles;
+    ct.bThreshBlur = blur;
+    ct.bGeneric = generic;
+    ct.uiCaptureWidth = opt.width;
+    ct.uiCaptureHeight = opt.height;
+    ct.ObjectMinsize = (opt.width * opt.height) / 100; /* same limits as -capsize */
+    ct.ObjectMaxsize = (opt.width * opt.height) / 4;
+
+    scene.Range(ct.iHSV);
+}
+
+// render into the input of the tracker, NV12 is what a camera would deliver (not timed)
+void Bench::Frame(ColourTracking& ct, SyntheticScene& scene, unsigned int f, std::vector<SyntheticScene::Truth>& truth)
+{
+    scene.Render(f, ct.imgOriginal, truth);
+    
+    if (format == INPUT_BGR) return;
+    
+    cv::Mat i420; /* Y plane, U plane, V plane */
+    cv::cvtColor(ct.imgOriginal, i420, cv::COLOR_BGR2YUV_I420);
+    
+    int w = ct.imgOriginal.cols, h = ct.imgOriginal.rows;
+    
+    ct.imgRaw.create(h * 3 / 2, w, CV_8UC1);
+    i420.rowRange(0, h).copyTo(ct.imgRaw.rowRange(0, h));
+    
+    const uchar* u = i420.ptr<uchar>(h);
+    const uchar* v = u + (w / 2) * (h / 2);
+    uchar* uv = ct.imgRaw.ptr<uchar>(h);
+    
+    for (int k = 0; k < (w / 2) * (h / 2); k++) {
+        uv[2*k] = u[k];
+        uv[2*k+1] = v[k];
+    }
+}
+
+void Bench::TimeStages(ColourTracking& ct, SyntheticScene& scene, Stages& st)
+{
+    std::vector<SyntheticScene::Truth> truth;
+
+    st.threshold = st.morph = st.find = st.associate = st.serialise = 0;
+    st.sparse = st.mismatch = 0;
+
+    for (unsigned int f = 0; f < frames; f++) {
+
+        Frame(ct, scene, f, truth);
+        ct.frame_time = f;
+        ct.UpdateConfig();
+
+        const TrackerConfig& c = *ct.cfg;
+
+        steady_clock::time_point t0 = steady_clock::now();
+        if (format != INPUT_BGR) ct.PrepareYUV();
+        ct.tmOccupied.Reset(ct.FrameSize());
+        ct.ThresholdFrame(cv::Rect(cv::Point(0, 0), ct.FrameSize()), 1, ct.imgThresh, ct.bSparse ? &ct.tmOccupied : NULL);
+        bool sparse = ct.bSparse && ct.tmOccupied.Regions(ct.vecRegions);
+        steady_clock::time_point t1 = steady_clock::now();
+        
+        cv::Mat dense = ct.imgThresh.clone(); /* reference for the tile path, not timed */
+        
+        steady_clock::time_point t2 = steady_clock::now();
+        if (sparse) {
+            for (unsigned int i = 0; i < ct.vecRegions.size(); i++) {
+                cv::Mat region = ct.imgThresh(ct.vecRegions[i]);
+                ct.MorphFrame(region, region);
+            }
+        }
+        else ct.MorphFrame(ct.imgThresh, ct.imgThresh);
+        steady_clock::time_point t3 = steady_clock::now();
+        if (sparse) ct.FindObjectsSparse(ct.imgThresh, ct.vecRegions, c.p.minsize, c.p.maxsize, ct.vecFoundObjects);
+        else ct.FindObjects(ct.imgThresh, c.p.minsize, c.p.maxsize, ct.vecFoundObjects);
+        steady_clock::time_point t4 = steady_clock::now();
+        ct.AddNewObjects(ct.vecFoundObjects, ct.tsExistingObjects);
+        ct.ExistentialObjects(ct.vecFoundObjects, ct.tsExistingObjects);
+        ct.CleanupObjects(ct.tsExistingObjects);
+        steady_clock::time_point t5 = steady_clock::now();
+        ct.WriteSendBuffer(ct.tsExistingObjects, ct.CommSendBuffer);
+        steady_clock::time_point t6 = steady_clock::now();
+        
+        if (sparse) {
+            std::vector<ColourTracking::Object> reference;
+            
+            ct.MorphFrame(dense, dense);
+            ct.FindObjects(dense, c.p.minsize, c.p.maxsize, reference);
+            
+            bool same = (reference.size() == ct.vecFoundObjects.size());
+            for (unsigned int i = 0; same && i < reference.size(); i++) {
+                same = reference[i].x == ct.vecFoundObjects[i].x && reference[i].y == ct.vecFoundObjects[i].y && reference[i].area == ct.vecFoundObjects[i].area;
+            }
+            
+            st.sparse++;
+            if (!same) st.mismatch++;
+        }
+
+        st.threshold += ns(t0, t1);
+        st.morph += ns(t2, t3);
+        st.find += ns(t3, t4);
+        st.associate += ns(t4, t5);
+        st.serialise += ns(t5, t6);
+    }
+}
+
+double Bench::TimePipeline(ColourTracking& ct, SyntheticScene& scene, Accuracy& acc)
+{
+    std::vector<SyntheticScene::Truth> truth;
+    std::map<unsigned int, unsigned int> ids; /* target -> last matched track ID */
+    double total = 0;
+
+    acc.truths = acc.matched = acc.missed = acc.falsetracks = acc.switches = 0;
+    acc.error = 0;
+
+    for (unsigned int f = 0; f < frames; f++) {
+
+        Frame(ct, scene, f, truth);
+
+        steady_clock::time_point t0 = steady_clock::now();
+        ct.Process();
+        total += ns(t0, steady_clock::now());
+
+        if (f >= ct.MinLife) Score(ct, truth, ids, acc); /* nothing can be reported before MinLife */
+    }
+
+    return total;
+}
+
+void Bench::Score(ColourTracking& ct, const std::vector<SyntheticScene::Truth>& truth, std::map<unsigned int, unsigned int>& ids, Accuracy& acc)
+{
+    const TrackStore& obj = ct.tsExistingObjects;
+    std::vector<bool> used(obj.size(), false);
+
+    for (unsigned int k = 0; k < truth.size(); k++) {
+
+        float gate = sqrt(truth[k].area / PI_VALUE); /* a reported centre must lie inside the object */
+        float best = gate;
+        int match = -1;
+
+        for (unsigned int i = 0; i < obj.size(); i++) {
+
+            if (used[i] || obj.lifecnt[i] < ct.MinLife) continue;
+
+            float d = sqrt((obj.x[i] - truth[k].x) * (obj.x[i] - truth[k].x) + (obj.y[i] - truth[k].y) * (obj.y[i] - truth[k].y));
+            if (d <= best) {
+                best = d;
+                match = i;
+            }
+        }
+
+        acc.truths++;
+
+        if (match < 0) {
+            acc.missed++;
+            continue;
+        }
+
+        used[match] = true;
+        acc.matched++;
+        acc.error += best;
+
+        std::map<unsigned int, unsigned int>::iterator last = ids.find(truth[k].id);
+        if (last != ids.end() && last->second != obj.id(match)) acc.switches++;
+        ids[truth[k].id] = obj.id(match);
+    }
+
+    for (unsigned int i = 0; i < obj.size(); i++) {
+        if (!used[i] && obj.lifecnt[i] >= ct.MinLife) acc.falsetracks++;
+    }
+}
+
+std::string Bench::Run(const SyntheticScene::Options& opt, const char* name, unsigned int pyramid)
+{
+    double pixels = (double) opt.width * opt.height * frames;
+    std::string json;
+
+    json = "{\"scene\":\"" + std::string(name) + "\"";
+    json += ",\"width\":" + std::to_string(opt.width) + ",\"height\":" + std::to_string(opt.height);
+    json += ",\"targets\":" + std::to_string(opt.targets) + ",\"distractors\":" + std::to_string(opt.distractors);
+    json += ",\"pyramid\":" + std::to_string(pyramid) + ",\"input\":\"" + (format == INPUT_BGR ? "bgr" : "nv12") + "\"";
+
+    // stages in isolation, only meaningful for the dense path
+    if (pyramid == 0) {
+        ColourTracking ct;
+        SyntheticScene scene(opt);
+        Stages st;
+
+        Configure(ct, scene, opt, pyramid);
+        TimeStages(ct, scene, st);
+
+        json += ",\"stages_ns_per_pixel\":{";
+        json += "\"threshold\":" + num(st.threshold / pixels);
+        json += ",\"morph\":" + num(st.morph / pixels);
+        json += ",\"find\":" + num(st.find / pixels);
+        json += ",\"associate\":" + num(st.associate / pixels);
+        json += ",\"serialise\":" + num(st.serialise / pixels) + "}";
+        json += ",\"tile_frames\":" + std::to_string(st.sparse) + ",\"tile_mismatch\":" + std::to_string(st.mismatch);
+    }
+
+    // full pipeline with a fresh tracker, scored against ground truth
+    ColourTracking ct;
+    SyntheticScene scene(opt);
+    Accuracy acc;
+
+    Configure(ct, scene, opt, pyramid);
+    double total = TimePipeline(ct, scene, acc);
+
+    json += ",\"fps\":" + num(frames / (total * 1e-9));
+    json += ",\"pipeline_ns_per_pixel\":" + num(total / pixels);
+    json += ",\"accuracy\":{";
+    json += "\"scored\":" + std::to_string(acc.truths);
+    json += ",\"missed\":" + std::to_string(acc.missed);
+    json += ",\"false_tracks\":" + std::to_string(acc.falsetracks);
+    json += ",\"id_switches\":" + std::to_string(acc.switches);
+    json += ",\"mean_error_px\":" + num(acc.matched ? acc.error / acc.matched : 0) + "}}";
+
+    std::cerr << name << " " << opt.width << "x" << opt.height << " targets:" << opt.targets << " pyramid:" << pyramid;
+    std::cerr << " fps:" << num(frames / (total * 1e-9)) << " missed:" << acc.missed << "/" << acc.truths;
+    std::cerr << " false:" << acc.falsetracks << " switches:" << acc.switches << std::endl;
+
+    return json;
+}
+
+std::string Bench::Kernels(const SyntheticScene::Options& opt)
+{
+    ColourTracking ct;
+    SyntheticScene scene(opt);
+    std::vector<SyntheticScene::Truth> truth;
+    std::vector<cv::Mat> images(frames);
+    
+    for (unsigned int f = 0; f < frames; f++) scene.Render(f, images[f], truth);
+    
+    double pixels = (double) opt.width * opt.height * frames;
+    std::string json = "{\"threshold\":[";
+    
+    for (int variant = 0; variant < KERNEL_VARIANTS; variant++) {
+        
+        int hsv[6] = { 50, 70, 100, 255, 50, 255 };
+        bool wrap = (variant & KERNEL_WRAP) != 0, hueonly = (variant & KERNEL_HUEONLY) != 0, blurred = (variant & KERNEL_BLUR) != 0;
+        
+        if (wrap) { hsv[0] = 170; hsv[1] = 10; }
+        if (hueonly) { hsv[2] = 0; hsv[3] = 255; hsv[4] = 0; hsv[5] = 255; }
+        
+        ThresholdKernel kernel = SelectThreshold(ThresholdVariant(hsv, blurred));
+        cv::Mat generic, special, diff;
+        double tg = 0, ts = 0;
+        int mismatch = 0; /* pixels where the two paths disagree, must be 0 */
+        
+        for (unsigned int f = 0; f < frames; f++) {
+            
+            steady_clock::time_point t0 = steady_clock::now();
+            ct.ThresholdImage(images[f], generic, hsv, blurred);
+            steady_clock::time_point t1 = steady_clock::now();
+            kernel(images[f], special, hsv, NULL);
+            steady_clock::time_point t2 = steady_clock::now();
+            
+            tg += ns(t0, t1);
+            ts += ns(t1, t2);
+            
+            cv::absdiff(generic, special, diff);
+            mismatch += cv::countNonZero(diff);
+        }
+        
+        if (variant > 0) json += ",";
+        json += "{\"wrap\":" + std::to_string((int) wrap) + ",\"hue_only\":" + std::to_string((int) hueonly);
+        json += ",\"blur\":" + std::to_string((int) blurred);
+        json += ",\"generic_ns_per_pixel\":" + num(tg / pixels);
+        json += ",\"specialised_ns_per_pixel\":" + num(ts / pixels);
+        json += ",\"speedup\":" + num(ts > 0 ? tg / ts : 0);
+        json += ",\"mismatch\":" + std::to_string(mismatch) + "}";
+        
+        std::cerr << "threshold wrap:" << wrap << " hue_only:" << hueonly << " blur:" << blurred;
+        std::cerr << " speedup:" << num(ts > 0 ? tg / ts : 0) << " mismatch:" << mismatch << std::endl;
+    }
+    
+    json += "],\"morph\":[";
+    
+    // masks of the default range, as the tracker morphs them
+    int hsv[6];
+    scene.Range(hsv);
+    
+    std::vector<cv::Mat> masks(frames);
+    for (unsigned int f = 0; f < frames; f++) ct.ThresholdImage(images[f], masks[f], hsv, true);
+    
+    cv::Mat ellipse = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(MORPH_KERNEL_SIZE, MORPH_KERNEL_SIZE));
+    
+    for (int level = 1; level < MORPH_LEVELS; level++) {
+        
+        MorphKernel kernel = SelectMorph(level);
+        cv::Mat generic, special, diff;
+        double tg = 0, ts = 0;
+        int mismatch = 0;
+        
+        for (unsigned int f = 0; f < frames; f++) {
+            
+            cv::Mat copy = masks[f].clone(); /* erode & dilate run in place, not timed */
+            
+            steady_clock::time_point t0 = steady_clock::now();
+            ct.MorphImage(level, ellipse, copy, generic);
+            steady_clock::time_point t1 = steady_clock::now();
+            kernel(masks[f], special);
+            steady_clock::time_point t2 = steady_clock::now();
+            
+            tg += ns(t0, t1);
+            ts += ns(t1, t2);
+            
+            cv::absdiff(generic, special, diff);
+            mismatch += cv::countNonZero(diff);
+        }
+        
+        if (level > 1) json += ",";
+        json += "{\"level\":" + std::to_string(level);
+        json += ",\"generic_ns_per_pixel\":" + num(tg / pixels);
+        json += ",\"specialised_ns_per_pixel\":" + num(ts / pixels);
+        json += ",\"speedup\":" + num(ts > 0 ? tg / ts : 0);
+        json += ",\"mismatch\":" + std::to_string(mismatch) + "}";
+        
+        std::cerr << "morph level:" << level << " speedup:" << num(ts > 0 ? tg / ts : 0) << " mismatch:" << mismatch << std::endl;
+    }
+    
+    return json + "]}";
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int frames = BENCH_FRAMES;
+    int morph = 1;
+    int format = INPUT_BGR;
+    bool tiles = true;
+    bool blur = true;
+    bool generic = false;
+    bool quick = false;
+    const char* out = NULL;
+
+    for (int j = 1; j < argc; j++) {
+        if (!strcmp(argv[j], "-help")) {
+            std::cout << "List of arguments:\n-frames # (Default is 200) frames per scene\n-morph # (0..2, default 1)\n";
+            std::cout << "-quick (only the default capture size)\n-json [file] (Default is stdout)\n";
+            std::cout << "-nv12 (feed NV12 frames, thresholded in YUV)\n-notiles (morph and search whole masks)\n";
+            std::cout << "-noblur (threshold without blur)\n-generic (threshold and morph without the specialised kernels)\n";
+            return 0;
+        }
+        else if (!strcmp(argv[j], "-frames") && j + 1 < argc) frames = std::atoi(argv[++j]);
+        else if (!strcmp(argv[j], "-morph") && j + 1 < argc) morph = std::atoi(argv[++j]);
+        else if (!strcmp(argv[j], "-json") && j + 1 < argc) out = argv[++j];
+        else if (!strcmp(argv[j], "-quick")) quick = true;
+        else if (!strcmp(argv[j], "-nv12")) format = INPUT_NV12;
+        else if (!strcmp(argv[j], "-notiles")) tiles = false;
+        else if (!strcmp(argv[j], "-noblur")) blur = false;
+        else if (!strcmp(argv[j], "-generic")) generic = true;
+    }
+
+    if (frames < 20 || morph < 0 || morph > 2) {
+        std::cout << "Use at least 20 frames and a morph level of 0..2.\n";
+        return -1;
+    }
+
+    // capture sizes in use, the first one is the default
+    const unsigned int sizes[][2] = { {CAP_WIDTH, CAP_HEIGHT}, {320, 240}, {640, 480}, {1024, 768} };
+    const unsigned int counts[] = { 1, 4, 12 };
+
+    Bench bench(frames, morph, format, tiles, blur, generic);
+    std::string json = "{\"version\":1,\"compiler\":\"" __VERSION__ "\"";
+    json += ",\"frames\":" + std::to_string(frames) + ",\"morph\":" + std::to_string(morph);
+    json += ",\"blur\":" + std::to_string((int) blur) + ",\"generic\":" + std::to_string((int) generic) + ",\"runs\":[";
+
+    bool first = true;
+
+    for (unsigned int s = 0; s < (quick ? 1 : 4); s++) {
+        for (unsigned int red = 0; red < 2; red++) {
+            for (unsigned int c = 0; c < 3; c++) {
+                for (unsigned int pyramid = 0; pyramid <= MAX_PYRAMID; pyramid++) {
+
+                    SyntheticScene::Options opt;
+                    opt.width = sizes[s][0];
+                    opt.height = sizes[s][1];
+                    opt.targets = counts[c];
+                    opt.distractors = counts[c] / 2 + 1;
+                    opt.red = red;
+                    opt.noise = BENCH_NOISE;
+                    opt.drift = BENCH_DRIFT;
+                    opt.seed = BENCH_SEED + 100 * s + 10 * c + red;
+
+                    if (!first) json += ",";
+                    json += bench.Run(opt, red ? "red" : "plain", pyramid);
+                    first = false;
+                }
+            }
+        }
+    }
+
+    // threshold and morph specialisations on the default capture size
+    SyntheticScene::Options kopt;
+    kopt.width = CAP_WIDTH;
+    kopt.height = CAP_HEIGHT;
+    kopt.targets = 4;
+    kopt.distractors = 3;
+    kopt.red = false;
+    kopt.noise = BENCH_NOISE;
+    kopt.drift = BENCH_DRIFT;
+    kopt.seed = BENCH_SEED;
+    
+    json += "],\"kernels\":" + bench.Kernels(kopt) + "}\n";
+
+    if (out != NULL) {
+        std::ofstream file(out);
+        file << json;
+    }
+    else std::cout << json;
+
+    return 0;
+}
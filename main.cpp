@@ -6,6 +6,7 @@
  */
 
 #include "ColourTracking.hpp"
+#include "RawVideo.hpp"
 
 #include "opencv2/highgui/highgui.hpp"
 
@@ -21,31 +22,68 @@ int main(int argc, char **argv)
         
     if (ct.CmdParameters(argc, argv) < 0) return -1; /* parse command line arguments */
     
+    if (!ct.Warmup()) return -1; /* socket, config and saved state are set up while the camera opens */
     
-    VideoCapture cap(0); /* initialize camera & video capturing */
     
-    if (!cap.isOpened()) /* if camera failed to initialize, exit program */
-    {
-         cout << ct.ts() << " Problem loading the camera. Exiting..\n";
-         return -1;
+    VideoCapture cap;
+    RawVideo raw; /* stands in for the camera with -rawinput */
+    
+    if (!ct.rawInput().empty()) {
+        
+        if (!raw.Open(ct.rawInput().c_str(), ct.inputFormat(), ct.width(), ct.height())) {
+            cout << ct.ts() << " Problem opening raw input " << ct.rawInput() << ". Exiting..\n";
+            return -1;
+        }
+        
+        cout << ct.ts() << " Reading raw frames HEIGHT:" << ct.height() << " WIDTH:" << ct.width() << endl;
     }
-
-    cap.set(CV_CAP_PROP_FRAME_WIDTH, ct.width());   /* set width and */ 
-    cap.set(CV_CAP_PROP_FRAME_HEIGHT, ct.height()); /* height of captured frame */
-
-    cout << ct.ts() << "Camera frame ";   /* print current frame size */
-    cout << " HEIGHT:" << cap.get(CV_CAP_PROP_FRAME_HEIGHT);
-    cout << " WIDTH:" << cap.get(CV_CAP_PROP_FRAME_WIDTH) << endl; 
+    else {
+        
+        cap.open(0); /* initialize camera & video capturing */
+        
+        if (!cap.isOpened()) /* if camera failed to initialize, exit program */
+        {
+             cout << ct.ts() << " Problem loading the camera. Exiting..\n";
+             return -1;
+        }
+        
+        cap.set(CV_CAP_PROP_FRAME_WIDTH, ct.width());   /* set width and */ 
+        cap.set(CV_CAP_PROP_FRAME_HEIGHT, ct.height()); /* height of captured frame */
+        
+        if (ct.inputFormat() == INPUT_YUYV) {
+            cap.set(CV_CAP_PROP_FOURCC, VideoWriter::fourcc('Y', 'U', 'Y', 'V'));
+            cap.set(CV_CAP_PROP_CONVERT_RGB, 0); /* frames come as they are, thresholded in YUV */
+        }
+        
+        cout << ct.ts() << "Camera frame ";   /* print current frame size */
+        cout << " HEIGHT:" << cap.get(CV_CAP_PROP_FRAME_HEIGHT);
+        cout << " WIDTH:" << cap.get(CV_CAP_PROP_FRAME_WIDTH) << endl; 
+    }
+    
     
+    ct.Milestone("camera");
     
     ct.CreateControlWindow(); /* create control panel with trackbars */
     
+    if (!ct.Ready()) return -1; /* socket setup failed */
+    
     while (true)
     {
 
         ct.t_start(); /* starting point for time measurement */
         
-        bool bSuccess = cap.read(ct.imgOriginal);
+        bool bSuccess;
+        
+        if (raw.isOpen()) {
+            if (!raw.Read(ct.imgRaw)) {
+                cout << ct.ts() << " End of raw input. Exiting..\n";
+                return 0;
+            }
+            bSuccess = true;
+        }
+        else if (ct.inputFormat() == INPUT_YUYV) bSuccess = cap.read(ct.imgRaw) && ct.RawLayout();
+        else bSuccess = cap.read(ct.imgOriginal);
+        
         if (!bSuccess){
             cout << ct.ts() << " Problem reading from camera to Mat.\n";
             return -1;
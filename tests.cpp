@@ -0,0 +1,583 @@
+/*
+ * File name: tests.cpp
+ * File description: Focused checks of the storage and tile code, exits non-zero when one fails.
+ *
+ */
+
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include "ColourTracking.hpp"
+#include "TrackStore.hpp"
+#include "TrackLog.hpp"
+#include "TileMap.hpp"
+#include "StateFile.hpp"
+#include "PixelKernels.hpp"
+#include "DebugLog.hpp"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define TESTS_SEED 12015
+
+static unsigned int checks = 0;
+static unsigned int failures = 0;
+
+#define CHECK(cond) do { checks++; if (!(cond)) { failures++; std::cout << __FILE__ << ":" << __LINE__ << " failed: " #cond "\n"; } } while (0)
+
+// unique file in the temp directory, removed by the caller
+static std::string TempPath()
+{
+    char path[] = "/tmp/pct_test_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd >= 0) close(fd);
+
+    return path;
+}
+
+/***************************** TrackStore *****************************/
+static void TestTrackStore()
+{
+    TrackStore s;
+    s.Init(4, 3);
+
+    int hsv[6] = { 50, 70, 100, 255, 50, 255 };
+    TrackStore::Handle h[4];
+
+    for (unsigned int i = 0; i < 4; i++) h[i] = s.Insert(i + 1, 10 * i, 20 * i, 100, 5, hsv);
+
+    CHECK(s.full());
+    CHECK(s.Insert(9, 0, 0, 100, 5, hsv).slot == INVALID_SLOT); /* refused, not evicted */
+    CHECK(s.overflows() == 1);
+
+    // removal moves the last track into the hole, handles follow it
+    s.Remove(1);
+    CHECK(s.size() == 3);
+    CHECK(s.id(0) == 1 && s.id(1) == 4 && s.id(2) == 3);
+    CHECK(s.Find(h[1]) == -1);
+    CHECK(s.Find(h[0]) == 0 && s.Find(h[3]) == 1 && s.Find(h[2]) == 2);
+    CHECK(s.x[s.Find(h[3])] == 30);
+
+    // a reused slot doesn't bring a stale handle back to life
+    TrackStore::Handle n = s.Insert(5, 1, 1, 100, 5, hsv);
+    CHECK(n.slot == h[1].slot);
+    CHECK(s.Find(h[1]) == -1);
+    CHECK(s.Find(n) == 3 && s.id(3) == 5);
+
+    // output order is still the order of insertion
+    std::vector<unsigned int> order;
+    s.InsertionOrder(order);
+    CHECK(order.size() == 4);
+    CHECK(s.id(order[0]) == 1 && s.id(order[1]) == 3 && s.id(order[2]) == 4 && s.id(order[3]) == 5);
+
+    // expired tracks go in one pass, including the ones moved into a hole
+    s.removcnt[s.Find(h[0])] = 0;
+    s.removcnt[s.Find(h[3])] = 0;
+    CHECK(s.RemoveExpired() == 2);
+    CHECK(s.size() == 2 && s.Find(h[0]) == -1 && s.Find(h[3]) == -1);
+    CHECK(s.FindId(5) >= 0 && s.FindId(3) >= 0 && s.FindId(4) == -1);
+    s.InsertionOrder(order);
+    CHECK(order.size() == 2 && s.id(order[0]) == 3 && s.id(order[1]) == 5);
+
+    // history ring keeps the newest entries, oldest first
+    int i = s.Find(n);
+    for (int k = 0; k < 5; k++) s.Record(i, 1000 + k, k, k, 100);
+    CHECK(s.historySize(i) == 3);
+    CHECK(s.historyAt(i, 0).t == 1002 && s.historyAt(i, 2).t == 1004);
+
+    s.Clear();
+    CHECK(s.empty());
+    CHECK(s.Find(n) == -1 && s.Find(h[2]) == -1);
+}
+/**********************************************************************/
+
+
+/****************************** TrackLog ******************************/
+// frames in the log, and whether they count up from 0 with a single restart at 'restart'
+static unsigned int CountFrames(const std::string& path, unsigned int restart, bool& ordered)
+{
+    TrackLogReader r;
+    TrackLogReader::Frame fr;
+    unsigned int n = 0;
+
+    ordered = r.Open(path.c_str());
+
+    while (ordered && r.Next(fr)) {
+        unsigned int f = (n < restart) ? n : n - restart;
+        ordered = ordered && fr.header->frame == f && fr.header->count == 3;
+        n++;
+    }
+
+    return n;
+}
+
+static void CutFile(const std::string& path, off_t size)
+{
+    CHECK(truncate(path.c_str(), size) == 0);
+}
+
+// a restarted writer appends after the last complete frame of the previous run
+static void TestTrackLogResume(const TrackStore& s)
+{
+    std::string path = TempPath();
+    TrackLogWriter w;
+    bool ordered;
+
+    const size_t frame = sizeof(tracklog::FrameHeader) + 3 * sizeof(tracklog::TrackRecord);
+    const unsigned int perblock = (TRACKLOG_BLOCK - sizeof(tracklog::BlockHeader)) / frame;
+
+    // frame cut short by a crash: dropped, the next run starts right after frame 98
+    CHECK(w.Open(path.c_str()));
+    for (unsigned int f = 0; f < 100; f++) w.Write(f, 1000 + f, s, 10);
+    w.Close();
+    CutFile(path, TRACKLOG_HEADER + sizeof(tracklog::BlockHeader) + 100 * frame - 7);
+
+    CHECK(w.Open(path.c_str()));
+    for (unsigned int f = 0; f < 50; f++) w.Write(f, 2000 + f, s, 10);
+    w.Close();
+    CHECK(CountFrames(path, 99, ordered) == 149 && ordered);
+
+    // block header cut short: the block is started again with the same number
+    unlink(path.c_str());
+    CHECK(w.Open(path.c_str()));
+    for (unsigned int f = 0; f < perblock + 90; f++) w.Write(f, 1000 + f, s, 10);
+    w.Close();
+    CutFile(path, TRACKLOG_HEADER + TRACKLOG_BLOCK + 10);
+
+    CHECK(w.Open(path.c_str()));
+    for (unsigned int f = 0; f < 5; f++) w.Write(f, 3000 + f, s, 10);
+    w.Close();
+    CHECK(CountFrames(path, perblock, ordered) == perblock + 5 && ordered);
+
+    TrackLogReader r;
+    TrackLogReader::Frame fr;
+    CHECK(r.Open(path.c_str()) && r.blocks() == 2);
+    CHECK(r.Seek(3000) && r.Next(fr) && fr.header->frame == 0 && fr.header->t == 3000);
+    r.Close();
+
+    // anything that isn't a track log is left alone
+    int fd = open(path.c_str(), O_WRONLY | O_TRUNC);
+    CHECK(write(fd, "not a track log\n", 16) == 16);
+    close(fd);
+    CHECK(!w.Open(path.c_str()));
+    struct stat st;
+    CHECK(stat(path.c_str(), &st) == 0 && st.st_size == 16);
+
+    unlink(path.c_str());
+}
+
+static void TestTrackLog()
+{
+    std::string path = TempPath();
+    int hsv[6] = { 50, 70, 100, 255, 50, 255 };
+
+    TrackStore s;
+    s.Init(MAX_TRACKS_LIMIT, 1);
+    for (unsigned int i = 0; i < 3; i++) s.Insert(i + 1, 10 * i, 20 * i, 100 + i, 5, hsv);
+    s.lifecnt[2] = 10;
+
+    // enough frames for several blocks, frame 7 is skipped, the last one has more tracks than fit in a block
+    const unsigned int frames = 10000;
+    TrackLogWriter w;
+    CHECK(w.Open(path.c_str()));
+
+    for (unsigned int f = 0; f < frames; f++) {
+        if (f != 7) w.Write(f, 1000 + 33 * f, s, 10);
+    }
+
+    TrackStore big;
+    big.Init(MAX_TRACKS_LIMIT, 1);
+    for (unsigned int i = 0; i < MAX_TRACKS_LIMIT; i++) big.Insert(i + 1, i % 640, i % 480, 50, 5, hsv);
+    w.Write(frames, 1000 + 33 * frames, big, 10);
+
+    w.Close();
+    CHECK(w.droppedFrames() == 0);
+    CHECK(w.truncatedFrames() == 1);
+
+    TrackLogReader r;
+    CHECK(r.Open(path.c_str()));
+    CHECK(r.blocks() > 1);
+
+    TrackLogReader::Frame fr;
+    unsigned int n = 0;
+    bool same = true;
+
+    while (r.Next(fr) && fr.header->frame < frames) {
+        unsigned int f = n + (n >= 7);
+        same = same && fr.header->frame == f && fr.header->t == 1000 + 33 * f && fr.header->count == 3 && fr.header->flags == 0;
+        same = same && fr.tracks[1].id == 2 && fr.tracks[1].x == 10 && fr.tracks[1].y == 20 && fr.tracks[1].area == 101;
+        same = same && fr.tracks[0].flags == 0 && fr.tracks[2].flags == tracklog::TRACK_CONFIRMED;
+        n++;
+    }
+    CHECK(same);
+    CHECK(n == frames - 1);
+
+    // the cut frame is the last one and says so
+    CHECK(fr.header->frame == frames);
+    CHECK(fr.header->flags & tracklog::FRAME_TRUNCATED);
+    CHECK(fr.header->count < MAX_TRACKS_LIMIT);
+    CHECK(!r.Next(fr));
+
+    // seek lands on the first frame at or after the time, across blocks
+    CHECK(r.Seek(1000 + 33 * 5000 - 1));
+    CHECK(r.Next(fr) && fr.header->frame == 5000);
+    CHECK(r.Seek(1000 + 33 * 7));
+    CHECK(r.Next(fr) && fr.header->frame == 8);
+    CHECK(!r.Seek(1000 + 33 * (frames + 1)));
+
+    r.Close();
+    unlink(path.c_str());
+
+    TestTrackLogResume(s);
+}
+/**********************************************************************/
+
+
+/***************************** StateFile ******************************/
+// sequence number of the snapshot as it is on disk
+static uint32_t SnapshotSeq(const std::string& path)
+{
+    trackstate::Header h;
+    int fd = open(path.c_str(), O_RDONLY);
+    ssize_t n = pread(fd, &h, sizeof(h), 0);
+    close(fd);
+
+    return (n == sizeof(h)) ? h.seq : 0;
+}
+
+// what a process killed in the middle of Save() leaves behind
+static void TearSnapshot(const std::string& path)
+{
+    uint32_t seq = SnapshotSeq(path) | 1;
+    int fd = open(path.c_str(), O_RDWR);
+    ssize_t n = pwrite(fd, &seq, sizeof(seq), offsetof(trackstate::Header, seq));
+    close(fd);
+
+    CHECK(n == sizeof(seq));
+}
+
+static void TestStateFile()
+{
+    std::string path = TempPath();
+    int hsv[6] = { 50, 70, 100, 255, 50, 255 };
+    unsigned int ids = 0;
+
+    TrackStore s, back;
+    s.Init(8, 1);
+    back.Init(8, 1);
+    for (unsigned int i = 0; i < 4; i++) s.Insert(i + 1, 10 * i, 20 * i, 100, 5, hsv);
+    s.Remove(0); /* dense order is now 4 2 3 */
+
+    std::vector<unsigned int> order;
+    s.InsertionOrder(order);
+
+    StateFile sf;
+    CHECK(sf.Open(path.c_str()));
+    CHECK(!sf.Restore(1000, 320, 240, back, ids)); /* new file: nothing to resume */
+
+    sf.Save(1000, 1, 320, 240, s, order, 4);
+    CHECK(sf.Restore(1000, 320, 240, back, ids));
+    CHECK(back.size() == 3 && ids == 4);
+    CHECK(back.id(0) == 2 && back.id(1) == 3 && back.id(2) == 4 && back.x[1] == 20); /* resumed in insertion order */
+    CHECK(!sf.Restore(1000, 640, 480, back, ids)); /* other capture size */
+    CHECK(!sf.Restore(1000 + STATEFILE_MAX_AGE + 1, 320, 240, back, ids)); /* too old */
+    sf.Close();
+
+    // torn snapshot is ignored after a restart
+    TearSnapshot(path);
+    CHECK(sf.Open(path.c_str()));
+    CHECK(!sf.Restore(1000, 320, 240, back, ids));
+
+    // first complete snapshot after that is valid again, and so are the following ones
+    for (unsigned int f = 2; f < 5; f++) {
+        sf.Save(1000 + f, f, 320, 240, s, order, 4);
+        CHECK((SnapshotSeq(path) & 1) == 0);
+        CHECK(sf.Restore(1000 + f, 320, 240, back, ids));
+    }
+    sf.Close();
+
+    // and a second crash is caught just like the first
+    TearSnapshot(path);
+    CHECK(sf.Open(path.c_str()));
+    CHECK(!sf.Restore(1005, 320, 240, back, ids));
+    sf.Save(1006, 6, 320, 240, s, order, 4);
+    CHECK(sf.Restore(1006, 320, 240, back, ids) && back.size() == 3);
+
+    std::vector<unsigned char> table(YUV_TABLE_BYTES, 1);
+    sf.SaveTable(hsv, table);
+    CHECK(sf.Table(hsv) != NULL);
+    sf.Close();
+
+    // file left by a build with other limits: nothing in it is trusted
+    CHECK(truncate(path.c_str(), STATEFILE_HEADER + 16 * sizeof(trackstate::Track)) == 0);
+    CHECK(sf.Open(path.c_str()));
+    CHECK(!sf.Restore(1006, 320, 240, back, ids));
+    CHECK(sf.Table(hsv) == NULL);
+
+    sf.Close();
+    unlink(path.c_str());
+}
+/**********************************************************************/
+
+
+/****************************** DebugLog ******************************/
+// rows logged in one record per frame must come out like one record per row, also across the end of the ring
+static void TestDebugLog()
+{
+    std::string path = TempPath();
+    std::string expect;
+    std::vector<int32_t> rows;
+
+    DebugLog log;
+    CHECK(log.Start(path.c_str()));
+
+    for (unsigned int f = 0; f < 500; f++) {
+
+        rows.clear();
+        for (int i = 0; i < 30; i++) {
+            int32_t v[4] = { (int32_t) f, i, -i, (int32_t) (f * i) };
+            rows.insert(rows.end(), v, v + 4);
+            expect += "<i>" + std::to_string(v[0]) + "<x>" + std::to_string(v[1]) + "<y>" + std::to_string(v[2]) + "<S>" + std::to_string(v[3]) + "\n";
+        }
+
+        log.LogRows(debuglog::SEND_OBJECT, f, 1000, rows.data(), 30, 4);
+
+        if (f % 100 == 99) usleep(100000); /* 9 slots a frame, the formatter catches up before the ring is full */
+    }
+
+    CHECK(log.dropped() == 0);
+
+    // rows that can never fit are dropped and counted, not split
+    rows.assign(20000 * 4, 0);
+    log.LogRows(debuglog::SEND_OBJECT, 500, 1000, rows.data(), 20000, 4);
+    CHECK(log.dropped() == 20000);
+
+    log.Stop();
+
+    std::string text;
+    char buf[4096];
+    FILE* f = fopen(path.c_str(), "r");
+    for (size_t n; f != NULL && (n = fread(buf, 1, sizeof(buf), f)) > 0; ) text.append(buf, n);
+    if (f != NULL) fclose(f);
+
+    CHECK(text.compare(0, expect.size(), expect) == 0);
+    CHECK(text.find("20000 records dropped") != std::string::npos);
+
+    unlink(path.c_str());
+}
+/**********************************************************************/
+
+
+/***************************** Threshold ******************************/
+// whole frame at once, as ColourTracking::ThresholdImage does it
+static void ThresholdWhole(const cv::Mat& src, cv::Mat& dst, const int hsv[], bool blur)
+{
+    cv::Mat buf;
+    cv::cvtColor(src, buf, cv::COLOR_BGR2HSV);
+    if (blur) cv::GaussianBlur(buf, buf, cv::Size(5,5), 0,0);
+
+    if (hsv[0] <= hsv[1]) cv::inRange(buf, cv::Scalar(hsv[0], hsv[2], hsv[4]), cv::Scalar(hsv[1], hsv[3], hsv[5]), dst);
+    else {
+        cv::Mat higher, lower;
+        cv::inRange(buf, cv::Scalar(hsv[0], hsv[2], hsv[4]), cv::Scalar(HHUE, hsv[3], hsv[5]), higher);
+        cv::inRange(buf, cv::Scalar(LHUE, hsv[2], hsv[4]), cv::Scalar(hsv[1], hsv[3], hsv[5]), lower);
+        dst = higher + lower;
+    }
+}
+
+// every threshold kernel must give the whole-frame mask and the tiles of a separate pass
+static void TestThreshold()
+{
+    cv::RNG rng(TESTS_SEED);
+    const int sizes[][2] = { {320, 240}, {333, 197}, {64, 31} };
+    const int ranges[][6] = { { 20, 90, 40, 255, 30, 230 }, { 170, 10, 40, 255, 30, 230 },
+                              { 20, 90, 0, 255, 0, 255 }, { 170, 10, 0, 255, 0, 255 } }; /* last two: hue only */
+
+    for (unsigned int s = 0; s < 3; s++) {
+        for (unsigned int k = 0; k < 16; k++) {
+
+            cv::Mat img(sizes[s][1], sizes[s][0], CV_8UC3);
+            rng.fill(img, cv::RNG::UNIFORM, 0, 256);
+            cv::GaussianBlur(img, img, cv::Size(7,7), 0,0); /* patches of similar colour */
+
+            const int* hsv = ranges[k & 3];
+            bool blur = (k & 4) != 0;
+
+            cv::Mat whole, bands;
+            ThresholdWhole(img, whole, hsv, blur);
+
+            TileMap marked, pass;
+            marked.Reset(img.size());
+            pass.Reset(img.size());
+            SelectThreshold(ThresholdVariant(hsv, blur))(img, bands, hsv, &marked);
+            for (int y = 0; y < whole.rows; y++) pass.MarkRow(y, whole.ptr<uchar>(y));
+
+            cv::Mat diff;
+            cv::absdiff(whole, bands, diff);
+            CHECK(cv::countNonZero(diff) == 0);
+
+            bool same = marked.count() == pass.count();
+            for (int ty = 0; same && ty * TILE_SIZE < img.rows; ty++) {
+                for (int tx = 0; tx * TILE_SIZE < img.cols; tx++) same = same && marked.occupied(tx, ty) == pass.occupied(tx, ty);
+            }
+            CHECK(same);
+        }
+    }
+}
+/**********************************************************************/
+
+
+/******************************* Morph ********************************/
+// erode & dilate steps of ColourTracking::MorphImage
+static void MorphSteps(int level, cv::Mat& img, const cv::Mat& kernel)
+{
+    if (level > 0) cv::erode(img, img, kernel);
+    if (level > 1) cv::dilate(img, img, kernel);
+    if (level > 1) cv::dilate(img, img, kernel);
+    if (level > 0) cv::erode(img, img, kernel);
+}
+
+// fused morph kernels must match erode & dilate, also in place on a region of a larger mask
+static void TestMorph()
+{
+    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(MORPH_KERNEL_SIZE, MORPH_KERNEL_SIZE));
+    cv::RNG rng(TESTS_SEED);
+    const int sizes[][2] = { {320, 240}, {333, 197}, {17, 5}, {1, 1} };
+
+    for (unsigned int s = 0; s < 4; s++) {
+        for (int level = 0; level < MORPH_LEVELS; level++) {
+
+            cv::Mat noise(sizes[s][1], sizes[s][0], CV_8U), mask;
+            rng.fill(noise, cv::RNG::UNIFORM, 0, 256);
+            cv::GaussianBlur(noise, noise, cv::Size(5,5), 0,0);
+            cv::threshold(noise, mask, 128, 255, cv::THRESH_BINARY); /* blobs, holes and single pixels */
+
+            cv::Mat expect = mask.clone(), got, diff;
+            MorphSteps(level, expect, kernel);
+
+            SelectMorph(level)(mask, got);
+            cv::absdiff(expect, got, diff);
+            CHECK(cv::countNonZero(diff) == 0);
+
+            // region morphed in place, its edges count as the border of an image
+            cv::Mat frame(mask.rows + 8, mask.cols + 8, CV_8U, cv::Scalar(255));
+            cv::Mat region = frame(cv::Rect(3, 5, mask.cols, mask.rows));
+            mask.copyTo(region);
+            SelectMorph(level)(region, region);
+            cv::absdiff(expect, region, diff);
+            CHECK(cv::countNonZero(diff) == 0);
+        }
+    }
+}
+/**********************************************************************/
+
+
+/****************************** TileMap *******************************/
+static void Morph(cv::Mat& img, const cv::Mat& kernel)
+{
+    cv::erode(img, img, kernel);
+    cv::dilate(img, img, kernel);
+    cv::dilate(img, img, kernel);
+    cv::erode(img, img, kernel);
+}
+
+// morph and contours only inside Regions() must match the whole mask
+static void TestTileMap()
+{
+    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(MORPH_KERNEL_SIZE, MORPH_KERNEL_SIZE));
+    cv::RNG rng(TESTS_SEED);
+    const int sizes[][2] = { {256, 256}, {320, 240}, {640, 480}, {333, 197} };
+    unsigned int sparse = 0;
+
+    for (unsigned int s = 0; s < 4; s++) {
+        for (unsigned int k = 0; k < 25; k++) {
+
+            cv::Size size(sizes[s][0], sizes[s][1]);
+            cv::Mat mask = cv::Mat::zeros(size, CV_8U);
+
+            // a few blobs plus single pixels, some on the frame edge
+            for (unsigned int b = 0; b < k % 6; b++) {
+                cv::Point c(rng.uniform(0, size.width), rng.uniform(0, size.height));
+                cv::circle(mask, c, rng.uniform(1, 40), cv::Scalar(255), -1);
+            }
+            for (unsigned int p = 0; p < k % 4; p++) mask.at<uchar>(rng.uniform(0, size.height), rng.uniform(0, size.width)) = 255;
+
+            TileMap tiles;
+            tiles.Reset(size);
+            for (int y = 0; y < size.height; y++) tiles.MarkRow(y, mask.ptr<uchar>(y));
+
+            std::vector<cv::Rect> regions;
+            if (!tiles.Regions(regions)) continue; /* tracker takes the whole frame path */
+            sparse++;
+
+            cv::Mat dense = mask.clone(), tiled = mask.clone();
+            Morph(dense, kernel);
+            for (unsigned int i = 0; i < regions.size(); i++) {
+                cv::Mat region = tiled(regions[i]);
+                Morph(region, kernel);
+            }
+
+            cv::Mat diff;
+            cv::absdiff(dense, tiled, diff);
+            CHECK(cv::countNonZero(diff) == 0);
+
+            std::vector<std::vector<cv::Point> > all, part, found;
+            cv::Mat search = dense.clone(); /* findContours may write to its input */
+            cv::findContours(search, all, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+            for (unsigned int i = 0; i < regions.size(); i++) {
+                cv::Mat region = tiled(regions[i]).clone();
+                part.clear();
+                cv::findContours(region, part, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE, regions[i].tl());
+                found.insert(found.end(), part.begin(), part.end());
+            }
+            CHECK(all.size() == found.size());
+        }
+    }
+
+    CHECK(sparse > 0);
+}
+/**********************************************************************/
+
+
+int main(int argc, char **argv)
+{
+    const char* only = NULL;
+
+    for (int j = 1; j < argc; j++) {
+        if (!strcmp(argv[j], "-help")) {
+            std::cout << "Usage: tests [group]\nGroups: trackstore, tracklog, statefile, debuglog, threshold, morph, tilemap (Default is all)\n";
+            return 0;
+        }
+        else only = argv[j];
+    }
+
+    struct { const char* name; void (*run)(); } groups[] = {
+        { "trackstore", TestTrackStore },
+        { "tracklog", TestTrackLog },
+        { "statefile", TestStateFile },
+        { "debuglog", TestDebugLog },
+        { "threshold", TestThreshold },
+        { "morph", TestMorph },
+        { "tilemap", TestTileMap }
+    };
+
+    for (unsigned int g = 0; g < sizeof(groups) / sizeof(groups[0]); g++) {
+
+        if (only != NULL && strcmp(only, groups[g].name)) continue;
+
+        unsigned int before = failures;
+        groups[g].run();
+        std::cout << groups[g].name << (failures == before ? " ok" : " FAILED") << std::endl;
+    }
+
+    std::cout << checks << " checks, " << failures << " failed" << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
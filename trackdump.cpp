@@ -0,0 +1,82 @@
+/*
+ * File name: trackdump.cpp
+ * File description: Prints a track log (-tracklog) as text, with a summary of gaps, truncated frames and restarts.
+ *
+ */
+
+#include "TrackLog.hpp"
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char **argv)
+{
+    const char* path = NULL;
+    int64_t from = 0;
+    bool quiet = false;
+
+    for (int j = 1; j < argc; j++) {
+        if (!strcmp(argv[j], "-help")) {
+            std::cout << "Usage: trackdump file [arguments]\nList of arguments:\n";
+            std::cout << "-from # (ms since epoch) start at the first frame recorded at or after this time\n";
+            std::cout << "-summary (only print the summary)\n";
+            return 0;
+        }
+        else if (!strcmp(argv[j], "-from") && j + 1 < argc) from = std::atoll(argv[++j]);
+        else if (!strcmp(argv[j], "-summary")) quiet = true;
+        else path = argv[j];
+    }
+
+    if (path == NULL) {
+        std::cout << "No track log given, see -help.\n";
+        return -1;
+    }
+
+    TrackLogReader reader;
+
+    if (!reader.Open(path)) {
+        std::cout << "Could not read track log " << path << ".\n";
+        return -1;
+    }
+
+    if (from > 0 && !reader.Seek(from)) {
+        std::cout << "Nothing recorded at or after " << from << ".\n";
+        return 0;
+    }
+
+    unsigned long frames = 0, tracks = 0, truncated = 0, missing = 0, restarts = 0;
+    uint32_t last = 0;
+    TrackLogReader::Frame f;
+
+    while (reader.Next(f)) {
+
+        const tracklog::FrameHeader* h = f.header;
+
+        // frame numbers count every processed frame, a gap means frames were dropped (or tracking was off)
+        if (frames > 0 && h->frame > last + 1) missing += h->frame - last - 1;
+        if (frames > 0 && h->frame <= last) restarts++; /* the tracker appended to the log after a restart */
+        last = h->frame;
+
+        frames++;
+        tracks += h->count;
+        if (h->flags & tracklog::FRAME_TRUNCATED) truncated++;
+
+        if (quiet) continue;
+
+        printf("frame %u t %lld tracks %u%s\n", h->frame, (long long) h->t, h->count,
+               (h->flags & tracklog::FRAME_TRUNCATED) ? " (truncated)" : "");
+
+        for (unsigned int i = 0; i < h->count; i++) {
+            const tracklog::TrackRecord& r = f.tracks[i];
+            printf("  id %u x %d y %d area %d life %u%s\n", r.id, r.x, r.y, r.area, r.life,
+                   (r.flags & tracklog::TRACK_CONFIRMED) ? " confirmed" : "");
+        }
+    }
+
+    printf("%lu frames in %u blocks, %lu tracks, %lu frames missing, %lu truncated, %lu restarts\n",
+           frames, reader.blocks(), tracks, missing, truncated, restarts);
+
+    return 0;
+}